@@ -0,0 +1,308 @@
+#include "../include/credential_manager.h"
+#include "../include/crypto_scheduler.h"
+#include "../include/sign_stream.h"
+#include "../../shared/include/hex_codec.h"
+
+#include <mbedtls_v3/bignum.h>
+#include <mbedtls_v3/rsa.h>
+#include <mbedtls_v3/sha256.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#define DEFAULT_ITERATIONS 200
+//Key generation is orders of magnitude slower than signing
+#define KEY_ITERATIONS_DIVIDER 20
+#define MIN_KEY_ITERATIONS 3
+//Chunk size of UpdateSign in CredentialManagerInterface
+#define STREAM_CHUNK_SIZE 1024
+//ORVD key size, Credential Manager expects 128-byte server signatures
+#define SERVER_KEY_SIZE 1024
+#define SERVER_KEY_BYTES (SERVER_KEY_SIZE / 8)
+
+//Messages signed by Navigation System, Periphery Controller and Flight Controller
+const char* callerMessages[CRYPTO_CALLER_NUMBER] = { "/api/telemetry?id=benchmark&lat=600026555&lon=278573348&alt=8000",
+    "/api/kill_switch?id=benchmark", "/api/fly_accept?id=benchmark" };
+
+//Sizes of a short command, an average telemetry message and the biggest message that fits into IPC
+const uint32_t messageSizes[] = { 64, 256, 1000 };
+//Sizes of a message that still fits into IPC, a batch of telemetry and a flight log
+const uint32_t streamMessageSizes[] = { 1000, 16384, 65536 };
+
+mbedtls_rsa_context serverRsa;
+
+//Key is never shared with the server in the benchmark
+int sendRequest(char* query, char* response) {
+    return 0;
+}
+
+void fillMessage(char* message, uint32_t size, int sequence) {
+    snprintf(message, size + 1, "/api/telemetry?id=benchmark&seq=%d&lat=600026555&lon=278573348&alt=8000&data=", sequence);
+    for (uint32_t i = strlen(message); i < size; i++)
+        message[i] = 'a' + i % 26;
+    message[size] = '\0';
+}
+
+int measure(std::vector<double> &latencies, int iterations, std::function<int()> operation) {
+    latencies.clear();
+    for (int i = 0; i < iterations; i++) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        if (!operation())
+            return 0;
+        latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+    }
+    return 1;
+}
+
+//One CSV line per case, in fixed order, so results of two runs can be compared line by line
+void printHeader() {
+    fprintf(stdout, "operation,algorithm,key_bits,message_bytes,iterations,ops_per_sec,mean_us,p50_us,p90_us,p99_us,max_us\n");
+}
+
+void printResult(const char* operation, const char* algorithm, int keyBits, uint32_t messageBytes, std::vector<double> &latencies) {
+    std::sort(latencies.begin(), latencies.end());
+    size_t size = latencies.size();
+    double total = 0;
+    for (double latency : latencies)
+        total += latency;
+    fprintf(stdout, "%s,%s,%d,%u,%zu,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f\n", operation, algorithm, keyBits, messageBytes, size,
+        1000000.0 * size / total, total / size, latencies[size / 2], latencies[(size * 90) / 100], latencies[(size * 99) / 100],
+        latencies[size - 1]);
+    fflush(stdout);
+}
+
+int initServerKey(char* key, uint32_t keySize) {
+    char n[2 * SERVER_KEY_BYTES + 4] = {0};
+    char e[2 * SERVER_KEY_BYTES + 4] = {0};
+    size_t resSize;
+    mbedtls_mpi N, E;
+    mbedtls_mpi_init(&N);
+    mbedtls_mpi_init(&E);
+    mbedtls_rsa_init(&serverRsa);
+    int result = (mbedtls_rsa_gen_key(&serverRsa, generateRandom, NULL, SERVER_KEY_SIZE, 65537) == 0)
+        && (mbedtls_rsa_export(&serverRsa, &N, NULL, NULL, NULL, &E) == 0)
+        && (mbedtls_mpi_write_string(&N, 16, n, sizeof(n), &resSize) == 0)
+        && (mbedtls_mpi_write_string(&E, 16, e, sizeof(e), &resSize) == 0);
+    mbedtls_mpi_free(&N);
+    mbedtls_mpi_free(&E);
+    snprintf(key, keySize, "$Key: %s %s", n, e);
+    return result;
+}
+
+//Server signs the hash the same way ORVD does: raw RSA over the zero-padded digest
+int signServerMessage(char* message, char* response, uint32_t responseSize) {
+    uint8_t block[SERVER_KEY_BYTES] = {0};
+    uint8_t signature[SERVER_KEY_BYTES] = {0};
+    if ((mbedtls_sha256((unsigned char*)message, strlen(message), block + SERVER_KEY_BYTES - 32, 0) != 0)
+        || (mbedtls_rsa_private(&serverRsa, generateRandom, NULL, block, signature) != 0))
+        return 0;
+    uint32_t length = snprintf(response, responseSize, "%s#", message);
+    bytesToHex(signature, SERVER_KEY_BYTES, response + length);
+    return 1;
+}
+
+//Key file in text format written by previous versions, it is converted to binary format on load
+int storeTextRsaKey() {
+    FILE* file = fopen(RSA_KEY_PATH, "w");
+    if (file == NULL)
+        return 0;
+    fprintf(file, "%s\n%s\n%s\n%s\n%s\n%s\n%s\n%s\n", getKeyN(), getKeyE(), getKeyD(), getKeyP(), getKeyQ(), getKeyDP(),
+        getKeyDQ(), getKeyQP());
+    fclose(file);
+    return 1;
+}
+
+//Message is signed by parts the way FinishSign does it
+int signStream(char* message, uint32_t messageSize, char* signature) {
+    uint32_t stream = 0;
+    uint8_t hash[32] = {0};
+    CryptoCaller caller;
+    if (!beginSignStream(stream))
+        return 0;
+    for (uint32_t offset = 0; offset < messageSize; offset += STREAM_CHUNK_SIZE)
+        if (!updateSignStream(stream, (uint8_t*)message + offset, std::min(messageSize - offset, (uint32_t)STREAM_CHUNK_SIZE)))
+            return 0;
+    return finishSignStream(stream, hash, caller) && signHash(hash, signature);
+}
+
+int measureStream(int iterations) {
+    std::vector<char> message(streamMessageSizes[sizeof(streamMessageSizes) / sizeof(streamMessageSizes[0]) - 1] + 1);
+    std::vector<double> latencies;
+    for (uint32_t messageSize : streamMessageSizes) {
+        fillMessage(message.data(), messageSize, 0);
+        //Message that fits into IPC has to get the same signature both ways
+        char signature[RSA_KEY_STRING_SIZE] = {0};
+        char streamSignature[RSA_KEY_STRING_SIZE] = {0};
+        if ((messageSize < STREAM_CHUNK_SIZE) && (!signMessage(message.data(), signature)
+            || !signStream(message.data(), messageSize, streamSignature) || strcmp(signature, streamSignature))) {
+            fprintf(stderr, "Signature of message signed by parts differs\n");
+            return 0;
+        }
+        if (!measure(latencies, iterations, [&]() { return signStream(message.data(), messageSize, streamSignature); }))
+            return 0;
+        printResult("signStream", "rsa", RSA_KEY_SIZE, messageSize, latencies);
+    }
+    return 1;
+}
+
+int checkResponse(char* response) {
+    uint8_t authenticity = 0;
+    return checkSignature(response, authenticity) && authenticity;
+}
+
+//Every response is checked once with distinct messages, then the first one is checked repeatedly as a poll answer
+int measureCheck(const char* algorithm, int keyBits, uint32_t messageSize, int iterations,
+    std::function<int(char* message, char* response, uint32_t responseSize)> signResponse) {
+    char message[1024] = {0};
+    std::vector<std::vector<char>> responses(iterations, std::vector<char>(2048));
+    for (int i = 0; i < iterations; i++) {
+        fillMessage(message, messageSize, i);
+        if (!signResponse(message, responses[i].data(), responses[i].size()))
+            return 0;
+    }
+
+    std::vector<double> latencies;
+    int index = 0;
+    if (!measure(latencies, iterations, [&responses, &index]() { return checkResponse(responses[index++].data()); }))
+        return 0;
+    printResult("checkSignature", algorithm, keyBits, messageSize, latencies);
+    if (!checkResponse(responses[0].data()) || !measure(latencies, iterations, [&responses]() { return checkResponse(responses[0].data()); }))
+        return 0;
+    printResult("checkSignature/cached", algorithm, keyBits, messageSize, latencies);
+    return 1;
+}
+
+//Callers sign back to back at the same time, either one by one as with a single receiving thread or through crypto workers
+int measureConcurrentSign(int iterations, bool scheduled) {
+    std::mutex serialMutex;
+    std::vector<double> latencies[CRYPTO_CALLER_NUMBER];
+    int results[CRYPTO_CALLER_NUMBER] = {0};
+    std::thread callers[CRYPTO_CALLER_NUMBER];
+    for (int i = 0; i < CRYPTO_CALLER_NUMBER; i++)
+        callers[i] = std::thread([&, i]() {
+            char message[1024] = {0};
+            strcpy(message, callerMessages[i]);
+            results[i] = measure(latencies[i], iterations, [&]() {
+                char signature[RSA_KEY_STRING_SIZE] = {0};
+                if (!scheduled) {
+                    std::lock_guard<std::mutex> lock(serialMutex);
+                    return signMessage(message, signature);
+                }
+                acquireCryptoWorker(classifyCryptoRequest(message));
+                int result = signMessage(message, signature);
+                releaseCryptoWorker();
+                return result;
+            });
+        });
+
+    int result = 1;
+    for (int i = 0; i < CRYPTO_CALLER_NUMBER; i++) {
+        callers[i].join();
+        result = result && results[i];
+    }
+    if (!result)
+        return 0;
+
+    char operation[64] = {0};
+    std::vector<double> allLatencies;
+    for (int i = 0; i < CRYPTO_CALLER_NUMBER; i++) {
+        snprintf(operation, sizeof(operation), "signMessage/%s/%s", scheduled ? "workers" : "serial", getCryptoCallerName((CryptoCaller)i));
+        allLatencies.insert(allLatencies.end(), latencies[i].begin(), latencies[i].end());
+        printResult(operation, "rsa", RSA_KEY_SIZE, strlen(callerMessages[i]), latencies[i]);
+    }
+    snprintf(operation, sizeof(operation), "signMessage/%s/all", scheduled ? "workers" : "serial");
+    printResult(operation, "rsa", RSA_KEY_SIZE, 0, allLatencies);
+    return 1;
+}
+
+int main(int argc, char** argv) {
+    int iterations = DEFAULT_ITERATIONS;
+    bool header = true;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--no-header"))
+            header = false;
+        else
+            iterations = atoi(argv[i]);
+    }
+    if (iterations <= 0) {
+        fprintf(stderr, "Usage: %s [iterations] [--no-header]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    int keyIterations = std::max(iterations / KEY_ITERATIONS_DIVIDER, MIN_KEY_ITERATIONS);
+
+    if (header)
+        printHeader();
+    std::vector<double> latencies;
+
+    if (!measure(latencies, keyIterations, generateRsaKey))
+        return EXIT_FAILURE;
+    printResult("generateRsaKey", "rsa", RSA_KEY_SIZE, 0, latencies);
+
+    //Without a key file the key is generated and stored, otherwise it is read and checked
+    if (!measure(latencies, keyIterations, []() { unlink(RSA_KEY_PATH); return getRsaKey(); }))
+        return EXIT_FAILURE;
+    printResult("getRsaKey/generate", "rsa", RSA_KEY_SIZE, 0, latencies);
+    if (!measure(latencies, iterations, getRsaKey))
+        return EXIT_FAILURE;
+    printResult("getRsaKey/load", "rsa", RSA_KEY_SIZE, 0, latencies);
+    if (!measure(latencies, keyIterations, []() { return storeTextRsaKey() && getRsaKey(); }))
+        return EXIT_FAILURE;
+    printResult("getRsaKey/convert", "rsa", RSA_KEY_SIZE, 0, latencies);
+    unlink(RSA_KEY_PATH);
+
+    if (!measure(latencies, iterations, generateEcdsaKey))
+        return EXIT_FAILURE;
+    printResult("generateEcdsaKey", "ecdsa-p256", 8 * ECDSA_KEY_BYTES, 0, latencies);
+
+    char serverKey[1024] = {0};
+    if (!initServerKey(serverKey, sizeof(serverKey)) || !setRsaKey(serverKey)) {
+        fprintf(stderr, "Failed to generate server key\n");
+        return EXIT_FAILURE;
+    }
+
+    char message[1024] = {0};
+    for (uint32_t messageSize : messageSizes) {
+        fillMessage(message, messageSize, 0);
+        if (!measure(latencies, iterations, [&message]() { char signature[RSA_KEY_STRING_SIZE] = {0}; return signMessage(message, signature); }))
+            return EXIT_FAILURE;
+        printResult("signMessage", "rsa", RSA_KEY_SIZE, messageSize, latencies);
+        if (!measureCheck("rsa", SERVER_KEY_SIZE, messageSize, iterations, signServerMessage))
+            return EXIT_FAILURE;
+    }
+
+    if (!measureStream(iterations))
+        return EXIT_FAILURE;
+
+    if (!measureConcurrentSign(iterations, false) || !measureConcurrentSign(iterations, true))
+        return EXIT_FAILURE;
+
+    //Credential Manager checks its own ECDSA signatures, as their cost does not depend on the key owner
+    snprintf(serverKey + strlen(serverKey), sizeof(serverKey) - strlen(serverKey), " ecdsa-p256 %s", getEcdsaKeyQ());
+    if (!setRsaKey(serverKey) || (getSignatureAlgorithm() != ECDSA_P256_SIGNATURE)) {
+        fprintf(stderr, "Failed to select ECDSA signature\n");
+        return EXIT_FAILURE;
+    }
+    for (uint32_t messageSize : messageSizes) {
+        fillMessage(message, messageSize, 0);
+        if (!measure(latencies, iterations, [&message]() { char signature[RSA_KEY_STRING_SIZE] = {0}; return signMessage(message, signature); }))
+            return EXIT_FAILURE;
+        printResult("signMessage", "ecdsa-p256", 8 * ECDSA_KEY_BYTES, messageSize, latencies);
+        if (!measureCheck("ecdsa-p256", 8 * ECDSA_KEY_BYTES, messageSize, iterations,
+            [](char* message, char* response, uint32_t responseSize) {
+                uint32_t length = snprintf(response, responseSize, "%s#", message);
+                return signMessage(message, response + length);
+            }))
+            return EXIT_FAILURE;
+    }
+
+    mbedtls_rsa_free(&serverRsa);
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,114 @@
+#include "../../shared/include/hex_codec.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <vector>
+
+#define DEFAULT_BATCHES 200
+//Single call is too short for the clock, so every sample is the mean of a batch
+#define BATCH_SIZE 1000
+
+//Sizes of ECDSA signature and public key, RSA-1024 and RSA-2048 signatures
+const uint32_t byteSizes[] = { 64, 65, 128, 256 };
+
+volatile uint8_t sink;
+
+//Codec used by Credential Manager before, kept for comparison
+uint8_t legacyHexCharToInt(char c) {
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    else if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    else if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    else
+        return 0;
+}
+
+void legacyStringToBytes(char* source, uint32_t sourceSize, uint8_t* destination, uint32_t destinationSize) {
+    int j = destinationSize - 1;
+    for (int32_t i = sourceSize - 1; (i >= 0) && (j >= 0); i -= 2) {
+        if (i > 0)
+            destination[j] = 16 * legacyHexCharToInt(source[i - 1]) + legacyHexCharToInt(source[i]);
+        else
+            destination[j] = legacyHexCharToInt(source[i]);
+        j--;
+    }
+}
+
+void legacyBytesToString(uint8_t* source, uint32_t size, char* destination) {
+    destination[0] = '\0';
+    for (uint32_t i = 0; i < size; i++) {
+        char hex[3] = {0};
+        sprintf(hex, "%02x", source[i]);
+        strcat(destination, hex);
+    }
+}
+
+void printHeader() {
+    fprintf(stdout, "operation,implementation,bytes,calls,calls_per_sec,mean_ns,p50_ns,p90_ns,p99_ns,max_ns\n");
+}
+
+void measure(const char* operation, const char* implementation, uint32_t bytes, int batches, std::function<void()> call) {
+    std::vector<double> latencies;
+    for (int i = 0; i < batches; i++) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (int j = 0; j < BATCH_SIZE; j++)
+            call();
+        latencies.push_back(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / BATCH_SIZE);
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    size_t size = latencies.size();
+    double total = 0;
+    for (double latency : latencies)
+        total += latency;
+    fprintf(stdout, "%s,%s,%u,%zu,%.0f,%.1f,%.1f,%.1f,%.1f,%.1f\n", operation, implementation, bytes, size * BATCH_SIZE,
+        1000000000.0 * size / total, total / size, latencies[size / 2], latencies[(size * 90) / 100], latencies[(size * 99) / 100],
+        latencies[size - 1]);
+}
+
+int main(int argc, char** argv) {
+    int batches = DEFAULT_BATCHES;
+    bool header = true;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--no-header"))
+            header = false;
+        else
+            batches = atoi(argv[i]);
+    }
+    if (batches <= 0) {
+        fprintf(stderr, "Usage: %s [batches] [--no-header]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (header)
+        printHeader();
+    for (uint32_t size : byteSizes) {
+        std::vector<uint8_t> bytes(size), decoded(size), legacyDecoded(size);
+        std::vector<char> hex(2 * size + 1), legacyHex(2 * size + 1);
+        for (uint32_t i = 0; i < size; i++)
+            bytes[i] = (uint8_t)(i * 37 + 11);
+
+        //Both implementations have to agree before they are compared
+        bytesToHex(bytes.data(), size, hex.data());
+        legacyBytesToString(bytes.data(), size, legacyHex.data());
+        hexToBytes(hex.data(), 2 * size, decoded.data(), size);
+        legacyStringToBytes(hex.data(), 2 * size, legacyDecoded.data(), size);
+        if (strcmp(hex.data(), legacyHex.data()) || (decoded != bytes) || (legacyDecoded != bytes)) {
+            fprintf(stderr, "Hex codecs give different results for %u bytes\n", size);
+            return EXIT_FAILURE;
+        }
+
+        measure("encode", "legacy", size, batches, [&]() { legacyBytesToString(bytes.data(), size, legacyHex.data()); sink = legacyHex[0]; });
+        measure("encode", "table", size, batches, [&]() { bytesToHex(bytes.data(), size, hex.data()); sink = hex[0]; });
+        measure("decode", "legacy", size, batches, [&]() { legacyStringToBytes(hex.data(), 2 * size, decoded.data(), size); sink = decoded[0]; });
+        measure("decode", "table", size, batches, [&]() { sink = hexToBytes(hex.data(), 2 * size, decoded.data(), size); });
+    }
+
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,91 @@
+#include "../include/credential_manager.h"
+
+#include <mbedtls_v3/bignum.h>
+#include <mbedtls_v3/rsa.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#define DEFAULT_ITERATIONS 200
+
+//Key is never shared with the server in the benchmark
+int sendRequest(char* query, char* response) {
+    return 0;
+}
+
+int setRsaKey(char* key) {
+    return 1;
+}
+
+int loadPlainKey(mbedtls_rsa_context &rsa) {
+    mbedtls_mpi N, D;
+    mbedtls_mpi_init(&N);
+    mbedtls_mpi_init(&D);
+    uint8_t n[RSA_KEY_BYTES] = {0};
+    uint8_t d[RSA_KEY_BYTES] = {0};
+    int result = (mbedtls_mpi_read_string(&N, 16, getKeyN()) == 0) && (mbedtls_mpi_read_string(&D, 16, getKeyD()) == 0)
+        && (mbedtls_mpi_write_binary(&N, n, RSA_KEY_BYTES) == 0) && (mbedtls_mpi_write_binary(&D, d, RSA_KEY_BYTES) == 0);
+    mbedtls_mpi_free(&N);
+    mbedtls_mpi_free(&D);
+
+    //The same key as Credential Manager used before, with D in place of the public exponent
+    mbedtls_rsa_init(&rsa);
+    return result && (mbedtls_rsa_import_raw(&rsa, n, RSA_KEY_BYTES, NULL, 0, NULL, 0, NULL, 0, d, RSA_KEY_BYTES) == 0);
+}
+
+void printLatency(const char* name, std::vector<double> &latencies) {
+    std::sort(latencies.begin(), latencies.end());
+    size_t size = latencies.size();
+    double total = 0;
+    for (double latency : latencies)
+        total += latency;
+    fprintf(stdout, "RSA-%d %s: median %.1f us, p99 %.1f us, mean %.1f us\n", RSA_KEY_SIZE, name,
+        latencies[size / 2], latencies[(size * 99) / 100], total / size);
+}
+
+int main(int argc, char** argv) {
+    int iterations = (argc > 1) ? atoi(argv[1]) : DEFAULT_ITERATIONS;
+    if (iterations <= 0) {
+        fprintf(stderr, "Usage: %s [iterations]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (!generateRsaKey())
+        return EXIT_FAILURE;
+    mbedtls_rsa_context plainRsa;
+    if (!loadPlainKey(plainRsa)) {
+        fprintf(stderr, "Failed to load RSA key without CRT parameters\n");
+        return EXIT_FAILURE;
+    }
+
+    char message[] = "/api/telemetry?id=benchmark&lat=600026555&lon=278573348&alt=8000&azimuth=90&dop=1.0&sats=12&speed=5";
+    std::vector<double> crtLatencies, plainLatencies;
+    for (int i = 0; i < iterations; i++) {
+        char signature[RSA_KEY_STRING_SIZE] = {0};
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        if (!signMessage(message, signature))
+            return EXIT_FAILURE;
+        crtLatencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+
+        uint8_t key[RSA_KEY_BYTES] = {0};
+        uint8_t result[RSA_KEY_BYTES] = {0};
+        key[RSA_KEY_BYTES - 1] = (uint8_t)i;
+        start = std::chrono::steady_clock::now();
+        if (mbedtls_rsa_public(&plainRsa, key, result) != 0) {
+            fprintf(stderr, "Failed to sign message without CRT\n");
+            return EXIT_FAILURE;
+        }
+        plainLatencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    printLatency("CRT sign", crtLatencies);
+    printLatency("plain sign", plainLatencies);
+    fprintf(stdout, "RSA-%d speedup: %.2fx\n", RSA_KEY_SIZE, plainLatencies[iterations / 2] / crtLatencies[iterations / 2]);
+    mbedtls_rsa_free(&plainRsa);
+
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
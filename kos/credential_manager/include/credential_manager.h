@@ -1,17 +1,71 @@
 #pragma once
 
+#include <stddef.h>
 #include <stdint.h>
 
+//Signature of a bigger key does not fit into MaxSignatureLength of CredentialManagerInterface
+#ifndef RSA_KEY_SIZE
+#define RSA_KEY_SIZE 1024
+#endif
+#define RSA_KEY_BYTES (RSA_KEY_SIZE / 8)
+//mbedtls_mpi_write_string reserves extra space for sign and rounding
+#define RSA_KEY_STRING_SIZE (2 * RSA_KEY_BYTES + 4)
+//Binary key file holds magic, format version and key size, then E (4 bytes), N and D (RSA_KEY_BYTES each),
+//P, Q, DP, DQ and QP (RSA_KEY_BYTES / 2 each) as big-endian numbers
+#define RSA_KEY_MAGIC "RSAK"
+#define RSA_KEY_FORMAT_VERSION 1
+#define RSA_KEY_BINARY_SIZE (12 + 2 * RSA_KEY_BYTES + 5 * (RSA_KEY_BYTES / 2))
+#define ECDSA_KEY_BYTES 32
+
+//Algorithms are offered to the server in the order of preference
+#define SIGNATURE_ALGORITHMS "ecdsa-p256,rsa"
+
+enum SignatureAlgorithm {
+    RSA_SIGNATURE,
+    ECDSA_P256_SIGNATURE,
+    SIGNATURE_ALGORITHM_NUMBER
+};
+
 int generateRsaKey();
-int loadRsaKey(uint8_t* N, uint8_t* D, char* n, char* e, uint32_t nLen, uint32_t eLen);
+int loadRsaKey(char* n, char* e, char* d, char* p, char* q, char* dp, char* dq, char* qp);
+int generateBinaryRsaKey(uint8_t* key);
+int exportBinaryRsaKey(uint8_t* key);
+int loadBinaryRsaKey(uint8_t* key, uint32_t keySize);
 int shareRsaKey();
 
 int getRsaKey();
+#ifdef RSA_KEY_PREGENERATION
+void startRsaKeyPregeneration();
+#endif
 int setRsaKey(char* key);
+void stringToBytes(char* source, uint32_t sourceSize, uint8_t* destination, uint32_t destinationSize);
+int generateRandom(void* context, unsigned char* output, size_t length);
+
+int generateEcdsaKey();
+int loadEcdsaKey(char* d, char* q);
+int getEcdsaKey();
+int setEcdsaServerKey(char* q, uint32_t qLength);
+
+SignatureAlgorithm getSignatureAlgorithm();
+int selectSignatureAlgorithm(char* name, uint32_t nameLength);
 
 int signMessage(char* message, char* sign);
+int signHash(uint8_t* hash, char* sign);
+int signRsaMessage(char* message, char* sign);
+int signRsaHash(uint8_t* hash, char* sign);
+int signEcdsaMessage(char* message, char* sign);
+int signEcdsaHash(uint8_t* hash, char* sign);
+int decryptMessage(uint8_t* encrypted, uint8_t* decrypted);
 int checkSignature(char* message, uint8_t &correct);
+int checkEcdsaSignature(char* message, uint32_t messageLength, char* sign, uint8_t &correct);
 
 char* getKeyN();
 char* getKeyE();
-char* getKeyD();
\ No newline at end of file
+char* getKeyD();
+char* getKeyP();
+char* getKeyQ();
+char* getKeyDP();
+char* getKeyDQ();
+char* getKeyQP();
+char* getEcdsaKeyD();
+char* getEcdsaKeyQ();
\ No newline at end of file
@@ -9,10 +9,31 @@ nk_err_t SignMessageImpl(struct CredentialManagerInterface *self,
 nk_err_t CheckSignatureImpl(struct CredentialManagerInterface *self,
                     const CredentialManagerInterface_CheckSignature_req *req, const struct nk_arena *reqArena,
                     CredentialManagerInterface_CheckSignature_res *res, struct nk_arena *resArena);
+nk_err_t BeginSignImpl(struct CredentialManagerInterface *self,
+                    const CredentialManagerInterface_BeginSign_req *req, const struct nk_arena *reqArena,
+                    CredentialManagerInterface_BeginSign_res *res, struct nk_arena *resArena);
+nk_err_t UpdateSignImpl(struct CredentialManagerInterface *self,
+                    const CredentialManagerInterface_UpdateSign_req *req, const struct nk_arena *reqArena,
+                    CredentialManagerInterface_UpdateSign_res *res, struct nk_arena *resArena);
+nk_err_t FinishSignImpl(struct CredentialManagerInterface *self,
+                    const CredentialManagerInterface_FinishSign_req *req, const struct nk_arena *reqArena,
+                    CredentialManagerInterface_FinishSign_res *res, struct nk_arena *resArena);
+nk_err_t CancelSignImpl(struct CredentialManagerInterface *self,
+                    const CredentialManagerInterface_CancelSign_req *req, const struct nk_arena *reqArena,
+                    CredentialManagerInterface_CancelSign_res *res, struct nk_arena *resArena);
+nk_err_t AppendTelemetryImpl(struct CredentialManagerInterface *self,
+                    const CredentialManagerInterface_AppendTelemetry_req *req, const struct nk_arena *reqArena,
+                    CredentialManagerInterface_AppendTelemetry_res *res, struct nk_arena *resArena);
+nk_err_t ConfirmTelemetryImpl(struct CredentialManagerInterface *self,
+                    const CredentialManagerInterface_ConfirmTelemetry_req *req, const struct nk_arena *reqArena,
+                    CredentialManagerInterface_ConfirmTelemetry_res *res, struct nk_arena *resArena);
 
 static struct CredentialManagerInterface *CreateCredentialManagerInterfaceImpl(void) {
     static const struct CredentialManagerInterface_ops Ops = {
-        .SignMessage = SignMessageImpl, .CheckSignature = CheckSignatureImpl
+        .SignMessage = SignMessageImpl, .CheckSignature = CheckSignatureImpl,
+        .BeginSign = BeginSignImpl, .UpdateSign = UpdateSignImpl, .FinishSign = FinishSignImpl,
+        .CancelSign = CancelSignImpl,
+        .AppendTelemetry = AppendTelemetryImpl, .ConfirmTelemetry = ConfirmTelemetryImpl
     };
 
     static CredentialManagerInterface obj = {
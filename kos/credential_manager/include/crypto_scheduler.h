@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stdint.h>
+
+//Number of crypto operations that run in parallel, each of them uses its own RSA context
+#ifndef CRYPTO_WORKERS
+#define CRYPTO_WORKERS 2
+#endif
+
+enum CryptoCaller {
+    NAVIGATION_CALLER,
+    PERIPHERY_CALLER,
+    FLIGHT_CALLER,
+    CRYPTO_CALLER_NUMBER
+};
+
+CryptoCaller classifyCryptoRequest(char* message);
+const char* getCryptoCallerName(CryptoCaller caller);
+
+void acquireCryptoWorker(CryptoCaller caller);
+void releaseCryptoWorker();
+uint32_t getCryptoWorker();
+
+void printCryptoStats();
\ No newline at end of file
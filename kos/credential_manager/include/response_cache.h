@@ -0,0 +1,12 @@
+#pragma once
+
+#include <stdint.h>
+
+//Number of verified server responses that are kept
+#ifndef RESPONSE_CACHE_SIZE
+#define RESPONSE_CACHE_SIZE 16
+#endif
+
+int findVerifiedResponse(char* response, uint8_t* digest, uint8_t &found);
+void storeVerifiedResponse(uint8_t* digest);
+void clearResponseCache();
\ No newline at end of file
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifndef SESSION_KEY_LIFETIME_S
+#define SESSION_KEY_LIFETIME_S 600
+#endif
+#define SESSION_KEY_SIZE 32
+//Epoch (8 hex digits), counter (16 hex digits) and HMAC-SHA256 (64 hex digits)
+#define SESSION_TOKEN_LENGTH 88
+
+int openSession();
+void closeSession();
+
+int signSessionMessage(char* message, char* sign);
+int isSessionToken(char* token);
+int checkSessionMessage(char* message, uint32_t messageLength, char* token, uint8_t &correct);
\ No newline at end of file
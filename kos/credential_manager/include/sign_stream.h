@@ -0,0 +1,19 @@
+#pragma once
+
+#include "crypto_scheduler.h"
+
+#include <stdint.h>
+
+//Number of messages that can be signed by parts at the same time
+#ifndef SIGN_STREAMS
+#define SIGN_STREAMS 4
+#endif
+//Stream that receives no parts for this long is given away to the next caller
+#ifndef SIGN_STREAM_TIMEOUT_S
+#define SIGN_STREAM_TIMEOUT_S 60
+#endif
+
+int beginSignStream(uint32_t &stream);
+int updateSignStream(uint32_t stream, uint8_t* chunk, uint32_t chunkSize);
+int finishSignStream(uint32_t stream, uint8_t* hash, CryptoCaller &caller);
+int cancelSignStream(uint32_t stream);
\ No newline at end of file
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <stdint.h>
+
+//Root of the telemetry tree is signed when the batch holds this many samples
+#ifndef TELEMETRY_TREE_SAMPLES
+#define TELEMETRY_TREE_SAMPLES 16
+#endif
+//or when the next sample comes this long after the first one of the batch
+#ifndef TELEMETRY_TREE_PERIOD_S
+#define TELEMETRY_TREE_PERIOD_S 10
+#endif
+
+int appendTelemetrySample(char* sample, uint32_t &batch, uint32_t &index);
+int confirmTelemetrySample(uint32_t batch, uint32_t index, char* root, uint32_t rootSize, uint8_t* rootHash);
\ No newline at end of file
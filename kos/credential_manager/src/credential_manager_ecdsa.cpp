@@ -0,0 +1,174 @@
+#include "../include/credential_manager.h"
+#include "../../shared/include/hex_codec.h"
+
+#include <mbedtls_v3/ecdsa.h>
+#include <mbedtls_v3/ecp.h>
+#include <mbedtls_v3/sha256.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#define ECDSA_POINT_SIZE 65
+
+mbedtls_ecp_group ecdsaGroup;
+mbedtls_mpi ecdsaSelfD;
+mbedtls_ecp_point ecdsaSelfQ;
+mbedtls_ecp_point ecdsaServerQ;
+bool ecdsaGroupLoaded = false;
+char ecdsaKeyD[2 * ECDSA_KEY_BYTES + 4] = {0};
+char ecdsaKeyQ[2 * ECDSA_POINT_SIZE + 1] = {0};
+
+int loadEcdsaGroup() {
+    if (ecdsaGroupLoaded)
+        return 1;
+    mbedtls_ecp_group_init(&ecdsaGroup);
+    mbedtls_mpi_init(&ecdsaSelfD);
+    mbedtls_ecp_point_init(&ecdsaSelfQ);
+    mbedtls_ecp_point_init(&ecdsaServerQ);
+    if (mbedtls_ecp_group_load(&ecdsaGroup, MBEDTLS_ECP_DP_SECP256R1) != 0) {
+        fprintf(stderr, "[%s] Error: Failed to load P-256 curve\n", ENTITY_NAME);
+        return 0;
+    }
+    ecdsaGroupLoaded = true;
+    return 1;
+}
+
+int hashMessage(char* message, uint32_t messageLength, uint8_t* hash) {
+    if (mbedtls_sha256((unsigned char*)message, messageLength, hash, 0) != 0) {
+        fprintf(stderr, "[%s] Warning: Failed to calculate message hash\n", ENTITY_NAME);
+        return 0;
+    }
+    return 1;
+}
+
+int verifyEcdsaHash(uint8_t* hash, char* sign, mbedtls_ecp_point* key) {
+    uint8_t signature[2 * ECDSA_KEY_BYTES] = {0};
+    stringToBytes(sign, strlen(sign), signature, sizeof(signature));
+    mbedtls_mpi r, s;
+    mbedtls_mpi_init(&r);
+    mbedtls_mpi_init(&s);
+    int result = (mbedtls_mpi_read_binary(&r, signature, ECDSA_KEY_BYTES) == 0)
+        && (mbedtls_mpi_read_binary(&s, signature + ECDSA_KEY_BYTES, ECDSA_KEY_BYTES) == 0)
+        && (mbedtls_ecdsa_verify(&ecdsaGroup, hash, 32, key, &r, &s) == 0);
+    mbedtls_mpi_free(&r);
+    mbedtls_mpi_free(&s);
+    return result;
+}
+
+int exportEcdsaKey() {
+    uint8_t point[ECDSA_POINT_SIZE] = {0};
+    size_t pointSize = 0;
+    size_t resSize;
+    if ((mbedtls_mpi_write_string(&ecdsaSelfD, 16, ecdsaKeyD, sizeof(ecdsaKeyD), &resSize) != 0)
+        || (mbedtls_ecp_point_write_binary(&ecdsaGroup, &ecdsaSelfQ, MBEDTLS_ECP_PF_UNCOMPRESSED, &pointSize, point, sizeof(point)) != 0))
+        return 0;
+    bytesToHex(point, pointSize, ecdsaKeyQ);
+    return 1;
+}
+
+int generateEcdsaKey() {
+    if (!loadEcdsaGroup())
+        return 0;
+    if ((mbedtls_ecp_gen_keypair(&ecdsaGroup, &ecdsaSelfD, &ecdsaSelfQ, generateRandom, NULL) != 0) || !exportEcdsaKey()) {
+        fprintf(stderr, "[%s] Error: Failed to generate ECDSA key\n", ENTITY_NAME);
+        return 0;
+    }
+    return 1;
+}
+
+int loadEcdsaKey(char* d, char* q) {
+    if (!loadEcdsaGroup())
+        return 0;
+    uint8_t point[ECDSA_POINT_SIZE] = {0};
+    uint32_t pointLength = strlen(q);
+    if (pointLength != 2 * ECDSA_POINT_SIZE) {
+        fprintf(stderr, "[%s] Error: Failed to load ECDSA key\n", ENTITY_NAME);
+        return 0;
+    }
+    stringToBytes(q, pointLength, point, ECDSA_POINT_SIZE);
+    if ((mbedtls_mpi_read_string(&ecdsaSelfD, 16, d) != 0) || (mbedtls_ecp_check_privkey(&ecdsaGroup, &ecdsaSelfD) != 0)
+        || (mbedtls_ecp_point_read_binary(&ecdsaGroup, &ecdsaSelfQ, point, ECDSA_POINT_SIZE) != 0)
+        || (mbedtls_ecp_check_pubkey(&ecdsaGroup, &ecdsaSelfQ) != 0) || !exportEcdsaKey()) {
+        fprintf(stderr, "[%s] Error: Failed to load ECDSA key\n", ENTITY_NAME);
+        return 0;
+    }
+
+    //Probe signature checks that D matches Q. It also caches multiples of the generator in the group,
+    //which is not safe to do later when crypto workers share it
+    char probe[] = "probe";
+    char signature[4 * ECDSA_KEY_BYTES + 1] = {0};
+    uint8_t hash[32] = {0};
+    if (!signEcdsaMessage(probe, signature) || !hashMessage(probe, strlen(probe), hash) || !verifyEcdsaHash(hash, signature, &ecdsaSelfQ)) {
+        fprintf(stderr, "[%s] Error: ECDSA key does not match its public part\n", ENTITY_NAME);
+        return 0;
+    }
+    return 1;
+}
+
+int setEcdsaServerKey(char* q, uint32_t qLength) {
+    if (!loadEcdsaGroup())
+        return 0;
+    uint8_t point[ECDSA_POINT_SIZE] = {0};
+    if (qLength != 2 * ECDSA_POINT_SIZE) {
+        fprintf(stderr, "[%s] Warning: Failed to parse public ECDSA key received from the server\n", ENTITY_NAME);
+        return 0;
+    }
+    stringToBytes(q, qLength, point, ECDSA_POINT_SIZE);
+    if ((mbedtls_ecp_point_read_binary(&ecdsaGroup, &ecdsaServerQ, point, ECDSA_POINT_SIZE) != 0)
+        || (mbedtls_ecp_check_pubkey(&ecdsaGroup, &ecdsaServerQ) != 0)) {
+        fprintf(stderr, "[%s] Warning: Public ECDSA key received from the server is not valid\n", ENTITY_NAME);
+        return 0;
+    }
+    return 1;
+}
+
+int signEcdsaMessage(char* message, char* sign) {
+    uint8_t hash[32] = {0};
+    if (!hashMessage(message, strlen(message), hash))
+        return 0;
+
+    return signEcdsaHash(hash, sign);
+}
+
+int signEcdsaHash(uint8_t* hash, char* sign) {
+    mbedtls_mpi r, s;
+    mbedtls_mpi_init(&r);
+    mbedtls_mpi_init(&s);
+    //Signature is sent as fixed-size R and S, which is shorter than DER
+    uint8_t signature[2 * ECDSA_KEY_BYTES] = {0};
+    int result = (mbedtls_ecdsa_sign(&ecdsaGroup, &r, &s, &ecdsaSelfD, hash, 32, generateRandom, NULL) == 0)
+        && (mbedtls_mpi_write_binary(&r, signature, ECDSA_KEY_BYTES) == 0)
+        && (mbedtls_mpi_write_binary(&s, signature + ECDSA_KEY_BYTES, ECDSA_KEY_BYTES) == 0);
+    mbedtls_mpi_free(&r);
+    mbedtls_mpi_free(&s);
+    if (!result) {
+        fprintf(stderr, "[%s] Warning: Failed to sign message\n", ENTITY_NAME);
+        return 0;
+    }
+
+    bytesToHex(signature, sizeof(signature), sign);
+    return 1;
+}
+
+int checkEcdsaSignature(char* message, uint32_t messageLength, char* sign, uint8_t &correct) {
+    correct = 0;
+    uint8_t hash[32] = {0};
+    if (!hashMessage(message, messageLength, hash))
+        return 0;
+
+    if (!verifyEcdsaHash(hash, sign, &ecdsaServerQ)) {
+        fprintf(stderr, "[%s] Warning: Authenticity is not confirmed\n", ENTITY_NAME);
+        return 0;
+    }
+
+    correct = 1;
+    return 1;
+}
+
+char* getEcdsaKeyD() {
+    return ecdsaKeyD;
+}
+
+char* getEcdsaKeyQ() {
+    return ecdsaKeyQ;
+}
\ No newline at end of file
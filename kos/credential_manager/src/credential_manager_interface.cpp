@@ -1,21 +1,25 @@
 #include "../include/credential_manager_interface.h"
 #include "../include/credential_manager.h"
+#include "../include/crypto_scheduler.h"
+#include "../include/sign_stream.h"
+#include "../include/telemetry_tree.h"
 
 #include <string.h>
 
 nk_err_t SignMessageImpl(struct CredentialManagerInterface *self,
                         const CredentialManagerInterface_SignMessage_req *req, const struct nk_arena *reqArena,
                         CredentialManagerInterface_SignMessage_res *res, struct nk_arena *resArena) {
-    char message[CredentialManagerInterface_MaxMessageLength] = {0};
     char signature[CredentialManagerInterface_MaxSignatureLength] = {0};
 
+    //Message is signed right in the request arena, it only has to be terminated
     nk_uint32_t len = 0;
     nk_char_t *msg = nk_arena_get(nk_char_t, reqArena, &(req->message), &len);
-    if (msg == NULL)
+    if ((msg == NULL) || !len || (msg[len - 1] != '\0'))
         return NK_EBADMSG;
-    strcpy(message, msg);
 
-    res->success = signMessage(message, signature);
+    acquireCryptoWorker(classifyCryptoRequest(msg));
+    res->success = signMessage(msg, signature);
+    releaseCryptoWorker();
 
     msg = nk_arena_alloc(nk_char_t, resArena, &(res->signature), strlen(signature) + 1);
     if (msg == NULL)
@@ -36,7 +40,107 @@ nk_err_t CheckSignatureImpl(struct CredentialManagerInterface *self,
         return NK_EBADMSG;
     strcpy(message, msg);
 
+    acquireCryptoWorker(classifyCryptoRequest(message));
     res->success = checkSignature(message, res->correct);
+    releaseCryptoWorker();
+
+    return NK_EOK;
+}
+
+nk_err_t BeginSignImpl(struct CredentialManagerInterface *self,
+                    const CredentialManagerInterface_BeginSign_req *req, const struct nk_arena *reqArena,
+                    CredentialManagerInterface_BeginSign_res *res, struct nk_arena *resArena) {
+    uint32_t stream = 0;
+    res->success = beginSignStream(stream);
+    res->stream = stream;
+
+    return NK_EOK;
+}
+
+nk_err_t UpdateSignImpl(struct CredentialManagerInterface *self,
+                    const CredentialManagerInterface_UpdateSign_req *req, const struct nk_arena *reqArena,
+                    CredentialManagerInterface_UpdateSign_res *res, struct nk_arena *resArena) {
+    //Chunk is hashed right in the request arena
+    nk_uint32_t len = 0;
+    nk_uint8_t *chunk = nk_arena_get(nk_uint8_t, reqArena, &(req->chunk), &len);
+    if (chunk == NULL)
+        return NK_EBADMSG;
+
+    res->success = updateSignStream(req->stream, chunk, len);
+
+    return NK_EOK;
+}
+
+nk_err_t FinishSignImpl(struct CredentialManagerInterface *self,
+                    const CredentialManagerInterface_FinishSign_req *req, const struct nk_arena *reqArena,
+                    CredentialManagerInterface_FinishSign_res *res, struct nk_arena *resArena) {
+    char signature[CredentialManagerInterface_MaxSignatureLength] = {0};
+    uint8_t hash[32] = {0};
+    CryptoCaller caller;
+
+    res->success = finishSignStream(req->stream, hash, caller);
+    if (res->success) {
+        acquireCryptoWorker(caller);
+        res->success = signHash(hash, signature);
+        releaseCryptoWorker();
+    }
+
+    nk_char_t *msg = nk_arena_alloc(nk_char_t, resArena, &(res->signature), strlen(signature) + 1);
+    if (msg == NULL)
+        return NK_EBADMSG;
+    strcpy(msg, signature);
+
+    return NK_EOK;
+}
+
+nk_err_t CancelSignImpl(struct CredentialManagerInterface *self,
+                    const CredentialManagerInterface_CancelSign_req *req, const struct nk_arena *reqArena,
+                    CredentialManagerInterface_CancelSign_res *res, struct nk_arena *resArena) {
+    res->success = cancelSignStream(req->stream);
+
+    return NK_EOK;
+}
+
+nk_err_t AppendTelemetryImpl(struct CredentialManagerInterface *self,
+                    const CredentialManagerInterface_AppendTelemetry_req *req, const struct nk_arena *reqArena,
+                    CredentialManagerInterface_AppendTelemetry_res *res, struct nk_arena *resArena) {
+    nk_uint32_t len = 0;
+    nk_char_t *msg = nk_arena_get(nk_char_t, reqArena, &(req->sample), &len);
+    if ((msg == NULL) || !len || (msg[len - 1] != '\0'))
+        return NK_EBADMSG;
+
+    uint32_t batch = 0;
+    uint32_t index = 0;
+    res->success = appendTelemetrySample(msg, batch, index);
+    res->batch = batch;
+    res->index = index;
+
+    return NK_EOK;
+}
+
+nk_err_t ConfirmTelemetryImpl(struct CredentialManagerInterface *self,
+                    const CredentialManagerInterface_ConfirmTelemetry_req *req, const struct nk_arena *reqArena,
+                    CredentialManagerInterface_ConfirmTelemetry_res *res, struct nk_arena *resArena) {
+    char root[CredentialManagerInterface_MaxMessageLength] = {0};
+    char signature[CredentialManagerInterface_MaxSignatureLength] = {0};
+    uint8_t hash[32] = {0};
+
+    res->success = confirmTelemetrySample(req->batch, req->index, root, sizeof(root), hash);
+    //Samples are only hashed, the root is signed once per batch with the asymmetric key like a signed stream
+    if (res->success && root[0]) {
+        acquireCryptoWorker(classifyCryptoRequest(root));
+        res->success = signHash(hash, signature);
+        releaseCryptoWorker();
+    }
+
+    nk_char_t *msg = nk_arena_alloc(nk_char_t, resArena, &(res->root), strlen(root) + 1);
+    if (msg == NULL)
+        return NK_EBADMSG;
+    strcpy(msg, root);
+    msg = nk_arena_alloc(nk_char_t, resArena, &(res->signature), strlen(signature) + 1);
+    if (msg == NULL)
+        return NK_EBADMSG;
+    strcpy(msg, signature);
 
     return NK_EOK;
 }
\ No newline at end of file
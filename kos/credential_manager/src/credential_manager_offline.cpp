@@ -4,6 +4,10 @@ int getRsaKey() {
     return generateRsaKey();
 }
 
+int getEcdsaKey() {
+    return generateEcdsaKey();
+}
+
 int setRsaKey(char* key) {
     return 1;
 }
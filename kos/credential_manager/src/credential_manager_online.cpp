@@ -1,89 +1,193 @@
 #include "../include/credential_manager.h"
+#include "../include/response_cache.h"
+#ifdef SESSION_AUTHENTICATION
+#include "../include/session_key.h"
+#endif
 
 #include <mbedtls_v3/rsa.h>
 #include <mbedtls_v3/sha256.h>
 
 #include <fcntl.h>
+#include <stdio.h>
 #include <unistd.h>
 #include <string.h>
+#ifdef RSA_KEY_PREGENERATION
+#include <thread>
+#endif
+
+#ifndef RSA_KEY_PATH
+#define RSA_KEY_PATH "/rsa"
+#endif
+#ifndef RSA_NEXT_KEY_PATH
+#define RSA_NEXT_KEY_PATH "/rsa.next"
+#endif
+#ifndef ECDSA_KEY_PATH
+#define ECDSA_KEY_PATH "/ecdsa"
+#endif
+
+#define RSA_KEY_FILE_LINES 8
+#define RSA_KEY_LEGACY_FILE_LINES 3
+#define RSA_KEY_TEXT_FILE_SIZE (RSA_KEY_FILE_LINES * RSA_KEY_STRING_SIZE)
 
 mbedtls_rsa_context rsaServer;
 
-uint8_t hexCharToInt(char c) {
-    if (c >= '0' && c <= '9')
-        return c - '0';
-    else if (c >= 'a' && c <= 'f')
-        return c - 'a' + 10;
-    else if (c >= 'A' && c <= 'F')
-        return c - 'A' + 10;
-    else {
-        fprintf(stderr, "[%s] Warning: %c is not a viable hex value\n", ENTITY_NAME, c);
+int readKeyFile(const char* path, uint8_t* key, uint32_t maxKeySize, uint32_t &keySize) {
+    keySize = 0;
+    int file = open(path, O_RDONLY);
+    if (file == -1)
         return 0;
+    //Whole file is requested at once, the loop only finishes reads that were cut short
+    while (keySize < maxKeySize) {
+        ssize_t readBytes = read(file, key + keySize, maxKeySize - keySize);
+        if (readBytes <= 0)
+            break;
+        keySize += readBytes;
     }
+    close(file);
+    return 1;
 }
 
-void stringToBytes(char* source, uint32_t sourceSize, uint8_t* destination) {
-    int j = 127;
-    for (int32_t i = sourceSize - 1; i >= 0; i -= 2) {
-        if (i > 0)
-            destination[j] = 16 * hexCharToInt(source[i - 1]) + hexCharToInt(source[i]);
-        else
-            destination[j] = hexCharToInt(source[i]);
-        j--;
+int writeKeyFile(const char* path, uint8_t* key, uint32_t keySize) {
+    //Key is written aside and renamed, so a reboot during writing does not leave a damaged key file
+    char tempPath[256] = {0};
+    snprintf(tempPath, sizeof(tempPath), "%s.tmp", path);
+    int file = open(tempPath, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (file == -1) {
+        fprintf(stderr, "[%s] Warning: Failed to create file to store RSA key\n", ENTITY_NAME);
+        return 0;
+    }
+    if (write(file, key, keySize) != keySize) {
+        fprintf(stderr, "[%s] Warning: Failed to store RSA key in file\n", ENTITY_NAME);
+        close(file);
+        return 0;
+    }
+    close(file);
+    if (rename(tempPath, path) != 0) {
+        fprintf(stderr, "[%s] Warning: Failed to store RSA key in file\n", ENTITY_NAME);
+        return 0;
     }
+    return 1;
+}
+
+int storeRsaKey() {
+    uint8_t key[RSA_KEY_BINARY_SIZE] = {0};
+    return exportBinaryRsaKey(key) && writeKeyFile(RSA_KEY_PATH, key, RSA_KEY_BINARY_SIZE);
+}
+
+int loadTextRsaKey(char* key, uint32_t keySize) {
+    char keys[RSA_KEY_FILE_LINES][RSA_KEY_STRING_SIZE] = {0};
+    uint32_t lineNumber = 0;
+    uint32_t j = 0;
+    for (uint32_t i = 0; (i < keySize) && (lineNumber < RSA_KEY_FILE_LINES); i++) {
+        if ((key[i] == '\n') || (key[i] == '\0')) {
+            if (j)
+                lineNumber++;
+            j = 0;
+            continue;
+        }
+        if (j == RSA_KEY_STRING_SIZE - 1) {
+            fprintf(stderr, "[%s] Warning: Failed to read RSA key from file\n", ENTITY_NAME);
+            return 0;
+        }
+        keys[lineNumber][j++] = key[i];
+    }
+    if (j && (lineNumber < RSA_KEY_FILE_LINES))
+        lineNumber++;
+
+    //Files written before CRT parameters were stored hold only N, E and D
+    if (lineNumber == RSA_KEY_LEGACY_FILE_LINES) {
+        if (!loadRsaKey(keys[0], keys[1], keys[2], NULL, NULL, NULL, NULL, NULL))
+            return 0;
+    }
+    else if ((lineNumber != RSA_KEY_FILE_LINES)
+        || !loadRsaKey(keys[0], keys[1], keys[2], keys[3], keys[4], keys[5], keys[6], keys[7])) {
+        fprintf(stderr, "[%s] Warning: Failed to read RSA key from file\n", ENTITY_NAME);
+        return 0;
+    }
+
+    //Text files are parsed slowly, so the key is stored again in binary format
+    fprintf(stderr, "[%s] Info: RSA key file is converted to binary format\n", ENTITY_NAME);
+    storeRsaKey();
+    return 1;
 }
 
 int getRsaKey() {
-    int file = open("/rsa", O_RDONLY);
+    //Buffer fits key file of any format, text one is the longest
+    uint8_t key[RSA_KEY_TEXT_FILE_SIZE] = {0};
+    uint32_t keySize = 0;
+    if (readKeyFile(RSA_KEY_PATH, key, sizeof(key), keySize)) {
+        if ((keySize >= 4) && !memcmp(key, RSA_KEY_MAGIC, 4))
+            return loadBinaryRsaKey(key, keySize);
+        return loadTextRsaKey((char*)key, keySize);
+    }
+
+#ifdef RSA_KEY_PREGENERATION
+    //Server pins the first key it receives, so the spare key is only used when there is no key yet
+    if (readKeyFile(RSA_NEXT_KEY_PATH, key, sizeof(key), keySize)) {
+        if (loadBinaryRsaKey(key, keySize) && (rename(RSA_NEXT_KEY_PATH, RSA_KEY_PATH) == 0)) {
+            fprintf(stderr, "[%s] Info: Pre-generated RSA key is used\n", ENTITY_NAME);
+            return 1;
+        }
+        fprintf(stderr, "[%s] Warning: Pre-generated RSA key is not valid\n", ENTITY_NAME);
+        unlink(RSA_NEXT_KEY_PATH);
+    }
+#endif
+
+    if (!generateRsaKey())
+        return 0;
+    return storeRsaKey();
+}
+
+#ifdef RSA_KEY_PREGENERATION
+void pregenerateRsaKey() {
+    //Spare key is kept until it is used, so it is generated once and not on every start
+    if (access(RSA_NEXT_KEY_PATH, F_OK) == 0)
+        return;
+    uint8_t key[RSA_KEY_BINARY_SIZE] = {0};
+    if (generateBinaryRsaKey(key) && writeKeyFile(RSA_NEXT_KEY_PATH, key, RSA_KEY_BINARY_SIZE))
+        fprintf(stderr, "[%s] Info: Spare RSA key is generated\n", ENTITY_NAME);
+}
+
+void startRsaKeyPregeneration() {
+    std::thread(pregenerateRsaKey).detach();
+}
+#endif
+
+int getEcdsaKey() {
+    int file = open(ECDSA_KEY_PATH, O_RDONLY);
     if (file == -1) {
-        if (!generateRsaKey())
+        if (!generateEcdsaKey())
             return 0;
-        file = open("/rsa", O_RDWR | O_CREAT);
+        file = open(ECDSA_KEY_PATH, O_WRONLY | O_CREAT | O_TRUNC, 0600);
         if (file == -1) {
-            fprintf(stderr, "[%s] Warning: Failed to create file to store generated RSA key\n", ENTITY_NAME);
+            fprintf(stderr, "[%s] Warning: Failed to create file to store generated ECDSA key\n", ENTITY_NAME);
             return 0;
         }
-        char key[1024] = {0};
-        sprintf(key, "%s\n%s\n%s\n", getKeyN(), getKeyE(), getKeyD());
+        char key[256] = {0};
+        snprintf(key, sizeof(key), "%s\n%s\n", getEcdsaKeyD(), getEcdsaKeyQ());
         uint32_t len = strlen(key);
         if (write(file, key, len) != len) {
-            fprintf(stderr, "[%s] Warning: Failed to store RSA key in file\n", ENTITY_NAME);
+            fprintf(stderr, "[%s] Warning: Failed to store ECDSA key in file\n", ENTITY_NAME);
             close(file);
             return 0;
         }
         close(file);
         return 1;
     }
-    else {
-        char keys[3][257] = {0};
-        uint32_t lens[3] = {0};
-        for (int i = 0; i < 3; i++) {
-            int j = 0;
-            while (true) {
-                char letter;
-                if (read(file, &letter, 1) != 1) {
-                    fprintf(stderr, "[%s] Warning: Failed to read RSA key from file\n", ENTITY_NAME);
-                    close(file);
-                    return 0;
-                }
-                if ((letter == '\n') || (letter == '\0'))
-                    break;
-                keys[i][j] = letter;
-                j++;
-            }
-            keys[i][j] = '\0';
-            lens[i] = j;
-        }
-        close(file);
 
-        uint8_t N[128] = {0};
-        uint8_t D[128] = {0};
-
-        stringToBytes(keys[0], lens[0], N);
-        stringToBytes(keys[2], lens[2], D);
-
-        return loadRsaKey(N, D, keys[0], keys[1], lens[0], lens[1]);
+    char key[256] = {0};
+    ssize_t readBytes = read(file, key, sizeof(key) - 1);
+    close(file);
+    char* qStart = (readBytes > 0) ? strchr(key, '\n') : NULL;
+    if (qStart == NULL) {
+        fprintf(stderr, "[%s] Warning: Failed to read ECDSA key from file\n", ENTITY_NAME);
+        return 0;
     }
+    *qStart = '\0';
+    qStart++;
+    qStart[strcspn(qStart, "\n")] = '\0';
+
+    return loadEcdsaKey(key, qStart);
 }
 
 int setRsaKey(char* key) {
@@ -106,12 +210,33 @@ int setRsaKey(char* key) {
     uint8_t N[128] = {0};
     uint8_t E[128] = {0};
 
-    stringToBytes(nStart, eStart - nStart, N);
+    stringToBytes(nStart, eStart - nStart, N, 128);
     eStart++;
-    stringToBytes(eStart, strlen(eStart), E);
+    //Server that supports one of the offered algorithms appends its name and own public key for it
+    char* algorithmStart = strstr(eStart, " ");
+    stringToBytes(eStart, (algorithmStart != NULL) ? (algorithmStart - eStart) : strlen(eStart), E, 128);
 
+    //Responses verified with the previous server key are not trusted anymore
+    clearResponseCache();
+    mbedtls_rsa_free(&rsaServer);
     mbedtls_rsa_init(&rsaServer);
     mbedtls_rsa_import_raw(&rsaServer, N, 128, NULL, 0, NULL, 0, NULL, 0, E, 128);
+    //Montgomery constant is cached on the first public operation, which has to happen before crypto workers share the key
+    uint8_t probe[128] = {0};
+    uint8_t probeResult[128] = {0};
+    mbedtls_rsa_public(&rsaServer, probe, probeResult);
+
+    if (algorithmStart != NULL) {
+        algorithmStart++;
+        char* serverKeyStart = strstr(algorithmStart, " ");
+        uint32_t algorithmLength = (serverKeyStart != NULL) ? (serverKeyStart - algorithmStart) : strlen(algorithmStart);
+        char ecdsaName[] = "ecdsa-p256";
+        int ecdsaSelected = (algorithmLength == strlen(ecdsaName)) && !strncmp(algorithmStart, ecdsaName, algorithmLength);
+        //Without a valid server key its signatures could not be checked, so RSA is kept
+        if (ecdsaSelected && ((serverKeyStart == NULL) || !setEcdsaServerKey(serverKeyStart + 1, strlen(serverKeyStart + 1))))
+            return 1;
+        selectSignatureAlgorithm(algorithmStart, algorithmLength);
+    }
 
     return 1;
 }
@@ -125,6 +250,27 @@ int checkSignature(char* message, uint8_t &correct) {
         return 0;
     }
     uint32_t messageLength = signatureStart - message;
+#ifdef SESSION_AUTHENTICATION
+    //Session responses are unique and go through replay check, so they are never cached
+    if (isSessionToken(signatureStart + 1))
+        return checkSessionMessage(message, messageLength, signatureStart + 1, correct);
+#endif
+
+    //Answers to polls are byte-identical, so their signatures do not need to be checked again
+    uint8_t responseDigest[32] = {0};
+    uint8_t cached = 0;
+    int cacheable = findVerifiedResponse(message, responseDigest, cached);
+    if (cacheable && cached) {
+        correct = 1;
+        return 1;
+    }
+    if ((getSignatureAlgorithm() == ECDSA_P256_SIGNATURE) && (strlen(signatureStart + 1) == 4 * ECDSA_KEY_BYTES)) {
+        if (!checkEcdsaSignature(message, messageLength, signatureStart + 1, correct))
+            return 0;
+        if (cacheable)
+            storeVerifiedResponse(responseDigest);
+        return 1;
+    }
 
     uint8_t hash[32] = {0};
     mbedtls_sha256_context sha256;
@@ -149,7 +295,7 @@ int checkSignature(char* message, uint8_t &correct) {
     uint8_t signature[128] = {0};
     uint8_t result[128] = {0};
     signatureStart++;
-    stringToBytes(signatureStart, strlen(signatureStart), signature);
+    stringToBytes(signatureStart, strlen(signatureStart), signature, 128);
     if (mbedtls_rsa_public(&rsaServer, signature, result) != 0) {
         fprintf(stderr, "[%s] Warning: Failed to decode server signature\n", ENTITY_NAME);
         return 0;
@@ -165,6 +311,20 @@ int checkSignature(char* message, uint8_t &correct) {
         j--;
     }
 
+    char verificationFailure[] = "$Signature verification fail";
+    int verificationFailed = (messageLength == strlen(verificationFailure)) && !strncmp(message, verificationFailure, messageLength);
+#ifdef SESSION_AUTHENTICATION
+    //Server does not know the session anymore, for example after restart, so a new one has to be opened
+    if (verificationFailed)
+        closeSession();
+#endif
+    //Failure answer can be replayed, so the negotiated algorithm is never changed by it
+    if (verificationFailed)
+        fprintf(stderr, "[%s] Warning: Server failed to verify a message signature\n", ENTITY_NAME);
+    //Failure answer has to reach the code above every time it is received
+    if (cacheable && !verificationFailed)
+        storeVerifiedResponse(responseDigest);
+
     correct = 1;
     return 1;
 }
\ No newline at end of file
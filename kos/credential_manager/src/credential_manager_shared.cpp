@@ -1,4 +1,9 @@
 #include "../include/credential_manager.h"
+#include "../include/crypto_scheduler.h"
+#ifdef SESSION_AUTHENTICATION
+#include "../include/session_key.h"
+#endif
+#include "../../shared/include/hex_codec.h"
 #include "../../shared/include/ipc_messages_server_connector.h"
 
 #include <mbedtls_v3/ctr_drbg.h>
@@ -7,15 +12,34 @@
 #include <mbedtls_v3/sha256.h>
 
 #include <string.h>
+#include <strings.h>
 #include <unistd.h>
+#include <atomic>
+#include <mutex>
 
 mbedtls_rsa_context rsaSelf;
-char keyE[257] = {0};
-char keyN[257] = {0};
-char keyD[257] = {0};
+//Private operations change blinding values in the context, so every crypto worker has its own copy
+mbedtls_rsa_context rsaWorkers[CRYPTO_WORKERS];
+mbedtls_entropy_context entropy;
+mbedtls_ctr_drbg_context drbg;
+std::mutex randomMutex;
+bool randomInitialized = false;
+char keyE[RSA_KEY_STRING_SIZE] = {0};
+char keyN[RSA_KEY_STRING_SIZE] = {0};
+char keyD[RSA_KEY_STRING_SIZE] = {0};
+char keyP[RSA_KEY_STRING_SIZE] = {0};
+char keyQ[RSA_KEY_STRING_SIZE] = {0};
+char keyDP[RSA_KEY_STRING_SIZE] = {0};
+char keyDQ[RSA_KEY_STRING_SIZE] = {0};
+char keyQP[RSA_KEY_STRING_SIZE] = {0};
+
+void stringToBytes(char* source, uint32_t sourceSize, uint8_t* destination, uint32_t destinationSize) {
+    if (!hexToBytes(source, sourceSize, destination, destinationSize))
+        fprintf(stderr, "[%s] Warning: %.*s is not a viable hex value\n", ENTITY_NAME, sourceSize, source);
+}
 
 void hashToKey(uint8_t* source, uint32_t sourceSize, uint8_t* destination) {
-    int j = 127;
+    int j = RSA_KEY_BYTES - 1;
     for (int i = sourceSize - 1; (i >= 0) && (j >= 0); i--) {
         destination[j] = source[i];
         j--;
@@ -23,83 +47,252 @@ void hashToKey(uint8_t* source, uint32_t sourceSize, uint8_t* destination) {
 }
 
 void bytesToString(uint8_t* source, char* destination) {
+    //Leading zero bytes are not written, as the server expects a number
     int start = 0;
-    for (int i = 0; i < 128; i++) {
-        if (!start && source[i])
-            start = 1;
-        if (start) {
-            char hex[3] = {0};
-            sprintf(hex, "%02x", source[i]);
-            strcat(destination, hex);
-        }
-    }
+    while ((start < RSA_KEY_BYTES) && !source[start])
+        start++;
+    bytesToHex(source + start, RSA_KEY_BYTES - start, destination);
 }
 
-int generateRsaKey() {
-    mbedtls_entropy_context entropy;
-    mbedtls_ctr_drbg_context drbg;
-    mbedtls_mpi N, E, D;
+struct SignatureBackend {
+    const char* name;
+    int (*sign)(char* message, char* sign);
+    int (*signHash)(uint8_t* hash, char* sign);
+};
+
+//Backends are indexed by SignatureAlgorithm
+static const SignatureBackend signatureBackends[SIGNATURE_ALGORITHM_NUMBER] = {
+    { "rsa", signRsaMessage, signRsaHash },
+    { "ecdsa-p256", signEcdsaMessage, signEcdsaHash }
+};
+std::atomic<SignatureAlgorithm> signatureAlgorithm(RSA_SIGNATURE);
+
+int initRandom() {
+    if (randomInitialized)
+        return 1;
 
+    //Random generator is kept for the whole run, as private RSA operations need it for blinding
     mbedtls_entropy_init(&entropy);
     mbedtls_ctr_drbg_init(&drbg);
-    mbedtls_rsa_init(&rsaSelf);
-    mbedtls_mpi_init(&N);
-    mbedtls_mpi_init(&E);
-    mbedtls_mpi_init(&D);
-
     if (mbedtls_ctr_drbg_seed(&drbg, mbedtls_entropy_func, &entropy, (unsigned char*)BOARD_ID, strlen(BOARD_ID)) != 0) {
         fprintf(stderr, "[%s] Error: Failed to get drbg seed\n", ENTITY_NAME);
         mbedtls_entropy_free(&entropy);
         mbedtls_ctr_drbg_free(&drbg);
-        mbedtls_mpi_free(&N);
-        mbedtls_mpi_free(&E);
-        mbedtls_mpi_free(&D);
         return 0;
     }
-    if(mbedtls_rsa_gen_key(&rsaSelf, mbedtls_ctr_drbg_random, &drbg, 1024, 65537) != 0) {
+
+    randomInitialized = true;
+    return 1;
+}
+
+int generateRandom(void* context, unsigned char* output, size_t length) {
+    std::lock_guard<std::mutex> lock(randomMutex);
+    if (!initRandom())
+        return MBEDTLS_ERR_CTR_DRBG_ENTROPY_SOURCE_FAILED;
+    return mbedtls_ctr_drbg_random(&drbg, output, length);
+}
+
+int exportRsaKey() {
+    mbedtls_mpi N, E, D, P, Q, DP, DQ, QP;
+    mbedtls_mpi* values[] = { &N, &E, &D, &P, &Q, &DP, &DQ, &QP };
+    char* strings[] = { keyN, keyE, keyD, keyP, keyQ, keyDP, keyDQ, keyQP };
+    uint32_t valueNumber = sizeof(values) / sizeof(values[0]);
+
+    for (uint32_t i = 0; i < valueNumber; i++)
+        mbedtls_mpi_init(values[i]);
+
+    int result = (mbedtls_rsa_export(&rsaSelf, &N, &P, &Q, &D, &E) == 0) && (mbedtls_rsa_export_crt(&rsaSelf, &DP, &DQ, &QP) == 0);
+    size_t resSize;
+    for (uint32_t i = 0; i < valueNumber; i++) {
+        if (result)
+            result = (mbedtls_mpi_write_string(values[i], 16, strings[i], RSA_KEY_STRING_SIZE, &resSize) == 0);
+        mbedtls_mpi_free(values[i]);
+    }
+
+    return result;
+}
+
+int copyRsaKey() {
+    for (int i = 0; i < CRYPTO_WORKERS; i++) {
+        mbedtls_rsa_free(&rsaWorkers[i]);
+        mbedtls_rsa_init(&rsaWorkers[i]);
+        if (mbedtls_rsa_copy(&rsaWorkers[i], &rsaSelf) != 0) {
+            fprintf(stderr, "[%s] Error: Failed to copy RSA key to crypto workers\n", ENTITY_NAME);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int generateRsaKey() {
+    if (!initRandom())
+        return 0;
+
+    mbedtls_rsa_free(&rsaSelf);
+    mbedtls_rsa_init(&rsaSelf);
+    if (mbedtls_rsa_gen_key(&rsaSelf, generateRandom, NULL, RSA_KEY_SIZE, 65537) != 0) {
         fprintf(stderr, "[%s] Error: Failed to generate RSA key\n", ENTITY_NAME);
-        mbedtls_entropy_free(&entropy);
-        mbedtls_ctr_drbg_free(&drbg);
-        mbedtls_mpi_free(&N);
-        mbedtls_mpi_free(&E);
-        mbedtls_mpi_free(&D);
         return 0;
     }
 
-    mbedtls_rsa_export(&rsaSelf, &N, NULL, NULL, &D, &E);
+    if (!exportRsaKey()) {
+        fprintf(stderr, "[%s] Error: Failed to export generated RSA key\n", ENTITY_NAME);
+        return 0;
+    }
 
-    size_t resSize;
-    mbedtls_mpi_write_string(&E, 16, keyE, 1024, &resSize);
-    mbedtls_mpi_write_string(&N, 16, keyN, 1024, &resSize);
-    mbedtls_mpi_write_string(&D, 16, keyD, 1024, &resSize);
+    return copyRsaKey();
+}
 
-    mbedtls_rsa_import(&rsaSelf, NULL, NULL, NULL, NULL, &D);
+int loadRsaKey(char* n, char* e, char* d, char* p, char* q, char* dp, char* dq, char* qp) {
+    if (!initRandom())
+        return 0;
+
+    mbedtls_mpi N, E, D, P, Q;
+    mbedtls_mpi_init(&N);
+    mbedtls_mpi_init(&E);
+    mbedtls_mpi_init(&D);
+    mbedtls_mpi_init(&P);
+    mbedtls_mpi_init(&Q);
+
+    //Without stored primes they are recovered from N, E and D by mbedtls_rsa_complete
+    int hasPrimes = (p != NULL) && (q != NULL);
+    int result = (mbedtls_mpi_read_string(&N, 16, n) == 0) && (mbedtls_mpi_read_string(&E, 16, e) == 0)
+        && (mbedtls_mpi_read_string(&D, 16, d) == 0);
+    if (result && hasPrimes)
+        result = (mbedtls_mpi_read_string(&P, 16, p) == 0) && (mbedtls_mpi_read_string(&Q, 16, q) == 0);
+
+    mbedtls_rsa_free(&rsaSelf);
+    mbedtls_rsa_init(&rsaSelf);
+    if (result)
+        result = (mbedtls_rsa_import(&rsaSelf, &N, hasPrimes ? &P : NULL, hasPrimes ? &Q : NULL, &D, &E) == 0)
+            && (mbedtls_rsa_complete(&rsaSelf) == 0) && (mbedtls_rsa_get_len(&rsaSelf) == RSA_KEY_BYTES);
 
-    mbedtls_entropy_free(&entropy);
-    mbedtls_ctr_drbg_free(&drbg);
     mbedtls_mpi_free(&N);
     mbedtls_mpi_free(&E);
     mbedtls_mpi_free(&D);
+    mbedtls_mpi_free(&P);
+    mbedtls_mpi_free(&Q);
 
-    return 1;
+    if (!result || !exportRsaKey()) {
+        fprintf(stderr, "[%s] Error: Failed to load RSA key\n", ENTITY_NAME);
+        return 0;
+    }
+
+    //Recovered primes keep the limb count of N, which makes CRT as slow as a plain modexp, so the key is imported again
+    if (!hasPrimes)
+        return loadRsaKey(keyN, keyE, keyD, keyP, keyQ, NULL, NULL, NULL);
+
+    //CRT parameters derived from the primes must match the stored ones, otherwise the key file is damaged
+    if (((dp != NULL) && strcasecmp(dp, keyDP)) || ((dq != NULL) && strcasecmp(dq, keyDQ)) || ((qp != NULL) && strcasecmp(qp, keyQP))) {
+        fprintf(stderr, "[%s] Error: Stored CRT parameters do not match RSA key\n", ENTITY_NAME);
+        return 0;
+    }
+
+    return copyRsaKey();
+}
+
+//Sizes of E, N, D, P, Q, DP, DQ and QP in binary key
+static const uint32_t binaryRsaKeySizes[] = { 4, RSA_KEY_BYTES, RSA_KEY_BYTES, RSA_KEY_BYTES / 2, RSA_KEY_BYTES / 2,
+    RSA_KEY_BYTES / 2, RSA_KEY_BYTES / 2, RSA_KEY_BYTES / 2 };
+static const uint32_t binaryRsaKeyValueNumber = sizeof(binaryRsaKeySizes) / sizeof(binaryRsaKeySizes[0]);
+
+int writeBinaryRsaKey(mbedtls_rsa_context &rsa, uint8_t* key) {
+    mbedtls_mpi N, E, D, P, Q, DP, DQ, QP;
+    mbedtls_mpi* values[] = { &E, &N, &D, &P, &Q, &DP, &DQ, &QP };
+    for (uint32_t i = 0; i < binaryRsaKeyValueNumber; i++)
+        mbedtls_mpi_init(values[i]);
+
+    memcpy(key, RSA_KEY_MAGIC, 4);
+    key[4] = RSA_KEY_FORMAT_VERSION;
+    key[5] = 0;
+    key[6] = (RSA_KEY_SIZE >> 8) & 0xFF;
+    key[7] = RSA_KEY_SIZE & 0xFF;
+    uint32_t offset = 8;
+    int result = (mbedtls_rsa_export(&rsa, &N, &P, &Q, &D, &E) == 0) && (mbedtls_rsa_export_crt(&rsa, &DP, &DQ, &QP) == 0);
+    for (uint32_t i = 0; i < binaryRsaKeyValueNumber; i++) {
+        if (result)
+            result = (mbedtls_mpi_write_binary(values[i], key + offset, binaryRsaKeySizes[i]) == 0);
+        offset += binaryRsaKeySizes[i];
+        mbedtls_mpi_free(values[i]);
+    }
+
+    return result;
+}
+
+int generateBinaryRsaKey(uint8_t* key) {
+    //Key is generated aside from the one in use, so it can be done while messages are signed
+    mbedtls_rsa_context rsa;
+    mbedtls_rsa_init(&rsa);
+    int result = (mbedtls_rsa_gen_key(&rsa, generateRandom, NULL, RSA_KEY_SIZE, 65537) == 0) && writeBinaryRsaKey(rsa, key);
+    mbedtls_rsa_free(&rsa);
+    if (!result)
+        fprintf(stderr, "[%s] Warning: Failed to generate next RSA key\n", ENTITY_NAME);
+    return result;
+}
+
+int exportBinaryRsaKey(uint8_t* key) {
+    return writeBinaryRsaKey(rsaSelf, key);
 }
 
-int loadRsaKey(uint8_t* N, uint8_t* D, char* n, char* e, uint32_t nLen, uint32_t eLen) {
+int loadBinaryRsaKey(uint8_t* key, uint32_t keySize) {
+    if (!initRandom())
+        return 0;
+
+    if ((keySize != RSA_KEY_BINARY_SIZE) || memcmp(key, RSA_KEY_MAGIC, 4) || (key[4] != RSA_KEY_FORMAT_VERSION)
+        || (((key[6] << 8) | key[7]) != RSA_KEY_SIZE)) {
+        fprintf(stderr, "[%s] Error: RSA key file has unknown format\n", ENTITY_NAME);
+        return 0;
+    }
+
+    mbedtls_mpi N, E, D, P, Q, DP, DQ, QP, derivedDP, derivedDQ, derivedQP;
+    mbedtls_mpi* values[] = { &E, &N, &D, &P, &Q, &DP, &DQ, &QP, &derivedDP, &derivedDQ, &derivedQP };
+    uint32_t valueNumber = sizeof(values) / sizeof(values[0]);
+    for (uint32_t i = 0; i < valueNumber; i++)
+        mbedtls_mpi_init(values[i]);
+
+    uint32_t offset = 8;
+    int result = 1;
+    for (uint32_t i = 0; i < binaryRsaKeyValueNumber; i++) {
+        if (result)
+            result = (mbedtls_mpi_read_binary(values[i], key + offset, binaryRsaKeySizes[i]) == 0);
+        offset += binaryRsaKeySizes[i];
+    }
+
+    //CRT parameters derived from the primes must match the stored ones, otherwise the key file is damaged
+    mbedtls_rsa_free(&rsaSelf);
     mbedtls_rsa_init(&rsaSelf);
-    mbedtls_rsa_import_raw(&rsaSelf, N, 128, NULL, 0, NULL, 0, NULL, 0, D, 128);
+    if (result)
+        result = (mbedtls_rsa_import(&rsaSelf, &N, &P, &Q, &D, &E) == 0) && (mbedtls_rsa_complete(&rsaSelf) == 0)
+            && (mbedtls_rsa_get_len(&rsaSelf) == RSA_KEY_BYTES)
+            && (mbedtls_rsa_export_crt(&rsaSelf, &derivedDP, &derivedDQ, &derivedQP) == 0)
+            && !mbedtls_mpi_cmp_mpi(&DP, &derivedDP) && !mbedtls_mpi_cmp_mpi(&DQ, &derivedDQ) && !mbedtls_mpi_cmp_mpi(&QP, &derivedQP);
 
-    for (int i = 0; i < nLen; i++)
-        keyN[i] = n[i];
-    for (int i = 0; i < eLen; i++)
-        keyE[i] = e[i];
+    for (uint32_t i = 0; i < valueNumber; i++)
+        mbedtls_mpi_free(values[i]);
 
-    return 1;
+    if (!result || !exportRsaKey()) {
+        fprintf(stderr, "[%s] Error: Failed to load RSA key\n", ENTITY_NAME);
+        return 0;
+    }
+
+    return copyRsaKey();
 }
 
 int shareRsaKey() {
     char rsaServerRequest[1024] = {0};
     char rsaServerResponse[1024] = {0};
-    snprintf(rsaServerRequest, 1024, "/api/key?%s&e=0x%s&n=0x%s", BOARD_ID, keyE, keyN);
+    char signature[RSA_KEY_STRING_SIZE] = {0};
+    snprintf(rsaServerRequest, 1024, "/api/key?%s&e=0x%s&n=0x%s&algs=%s&ec=0x%s", BOARD_ID, keyE, keyN,
+        SIGNATURE_ALGORITHMS, getEcdsaKeyQ());
+#ifdef TELEMETRY_TREE
+    //Server takes unsigned telemetry tree samples only from drones that asked for it at key exchange
+    strcat(rsaServerRequest, "&tree=1");
+#endif
+    //Request is signed with the shared RSA key, so the server accepts the ECDSA key only from the owner of the pinned RSA key
+    if (!signRsaMessage(rsaServerRequest, signature))
+        return 0;
+    uint32_t requestLength = strlen(rsaServerRequest);
+    snprintf(rsaServerRequest + requestLength, 1024 - requestLength, "&sig=0x%s", signature);
     while (!sendRequest(rsaServerRequest, rsaServerResponse)) {
         fprintf(stderr, "[%s] Warning: Failed to share RSA key. Trying again in 1s\n", ENTITY_NAME);
         sleep(1);
@@ -108,6 +301,35 @@ int shareRsaKey() {
 }
 
 int signMessage(char* message, char* sign) {
+#ifdef SESSION_AUTHENTICATION
+    //RSA signature is still used when there is no open session
+    if (signSessionMessage(message, sign))
+        return 1;
+#endif
+    return signatureBackends[signatureAlgorithm].sign(message, sign);
+}
+
+int signHash(uint8_t* hash, char* sign) {
+    return signatureBackends[signatureAlgorithm].signHash(hash, sign);
+}
+
+SignatureAlgorithm getSignatureAlgorithm() {
+    return signatureAlgorithm;
+}
+
+int selectSignatureAlgorithm(char* name, uint32_t nameLength) {
+    for (int i = 0; i < SIGNATURE_ALGORITHM_NUMBER; i++)
+        if ((strlen(signatureBackends[i].name) == nameLength) && !strncmp(name, signatureBackends[i].name, nameLength)) {
+            if (signatureAlgorithm != i)
+                fprintf(stderr, "[%s] Info: Messages are signed with %s\n", ENTITY_NAME, signatureBackends[i].name);
+            signatureAlgorithm = (SignatureAlgorithm)i;
+            return 1;
+        }
+    fprintf(stderr, "[%s] Warning: Signature algorithm %.*s is not supported\n", ENTITY_NAME, nameLength, name);
+    return 0;
+}
+
+int signRsaMessage(char* message, char* sign) {
     uint8_t hash[32] = {0};
     mbedtls_sha256_context sha256;
     mbedtls_sha256_init(&sha256);
@@ -128,11 +350,16 @@ int signMessage(char* message, char* sign) {
     }
     mbedtls_sha256_free(&sha256);
 
-    uint8_t key[128] = {0};
+    return signRsaHash(hash, sign);
+}
+
+int signRsaHash(uint8_t* hash, char* sign) {
+    uint8_t key[RSA_KEY_BYTES] = {0};
     hashToKey(hash, 32, key);
 
-    uint8_t result[128] = {0};
-    if (mbedtls_rsa_public(&rsaSelf, key, result) != 0) {
+    //Private operation uses CRT with stored primes, which is several times faster than modexp with D
+    uint8_t result[RSA_KEY_BYTES] = {0};
+    if (mbedtls_rsa_private(&rsaWorkers[getCryptoWorker()], generateRandom, NULL, key, result) != 0) {
         fprintf(stderr, "[%s] Warning: Failed to sign message\n", ENTITY_NAME);
         return 0;
     }
@@ -142,6 +369,14 @@ int signMessage(char* message, char* sign) {
     return 1;
 }
 
+int decryptMessage(uint8_t* encrypted, uint8_t* decrypted) {
+    if (mbedtls_rsa_private(&rsaWorkers[getCryptoWorker()], generateRandom, NULL, encrypted, decrypted) != 0) {
+        fprintf(stderr, "[%s] Warning: Failed to decrypt message\n", ENTITY_NAME);
+        return 0;
+    }
+    return 1;
+}
+
 char* getKeyN() {
     return keyN;
 }
@@ -152,4 +387,24 @@ char* getKeyE() {
 
 char* getKeyD() {
     return keyD;
+}
+
+char* getKeyP() {
+    return keyP;
+}
+
+char* getKeyQ() {
+    return keyQ;
+}
+
+char* getKeyDP() {
+    return keyDP;
+}
+
+char* getKeyDQ() {
+    return keyDQ;
+}
+
+char* getKeyQP() {
+    return keyQP;
 }
\ No newline at end of file
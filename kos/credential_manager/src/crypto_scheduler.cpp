@@ -0,0 +1,129 @@
+#include "../include/crypto_scheduler.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+#define CRYPTO_STATS_PERIOD 500
+#define NO_WORKER -1
+
+struct CallerPrefix {
+    const char* prefix;
+    CryptoCaller caller;
+};
+
+struct CryptoWaiter {
+    bool granted;
+    uint32_t worker;
+};
+
+struct CryptoCallerStats {
+    uint32_t served;
+    uint64_t totalWaitUs;
+    uint64_t maxWaitUs;
+};
+
+//IPC does not tell who the caller is, so it is recognized by the messages it signs and checks
+static const CallerPrefix callerPrefixes[] = {
+    { "/api/telemetry", NAVIGATION_CALLER },
+    { "/api/kill_switch", PERIPHERY_CALLER },
+    { "$KillSwitch", PERIPHERY_CALLER }
+};
+
+static const char* cryptoCallerNames[CRYPTO_CALLER_NUMBER] = { "navigation", "periphery", "flight" };
+
+std::mutex cryptoMutex;
+std::condition_variable cryptoCondition;
+std::deque<CryptoWaiter*> cryptoQueues[CRYPTO_CALLER_NUMBER];
+CryptoCallerStats cryptoStats[CRYPTO_CALLER_NUMBER];
+bool busyWorkers[CRYPTO_WORKERS] = {0};
+uint32_t nextCaller = 0;
+uint32_t releasedWorkers = 0;
+thread_local int32_t currentWorker = NO_WORKER;
+
+CryptoCaller classifyCryptoRequest(char* message) {
+    for (const CallerPrefix &callerPrefix : callerPrefixes)
+        if (!strncmp(message, callerPrefix.prefix, strlen(callerPrefix.prefix)))
+            return callerPrefix.caller;
+    return FLIGHT_CALLER;
+}
+
+const char* getCryptoCallerName(CryptoCaller caller) {
+    return cryptoCallerNames[caller];
+}
+
+void grantWorkers() {
+    for (uint32_t worker = 0; worker < CRYPTO_WORKERS; worker++) {
+        if (busyWorkers[worker])
+            continue;
+        //Callers take turns, so the one that signs often cannot hold back the others
+        int caller = -1;
+        for (uint32_t i = 0; i < CRYPTO_CALLER_NUMBER; i++)
+            if (!cryptoQueues[(nextCaller + i) % CRYPTO_CALLER_NUMBER].empty()) {
+                caller = (nextCaller + i) % CRYPTO_CALLER_NUMBER;
+                break;
+            }
+        if (caller == -1)
+            break;
+
+        CryptoWaiter* waiter = cryptoQueues[caller].front();
+        cryptoQueues[caller].pop_front();
+        waiter->granted = true;
+        waiter->worker = worker;
+        busyWorkers[worker] = true;
+        nextCaller = (caller + 1) % CRYPTO_CALLER_NUMBER;
+    }
+    cryptoCondition.notify_all();
+}
+
+void acquireCryptoWorker(CryptoCaller caller) {
+    std::unique_lock<std::mutex> lock(cryptoMutex);
+    std::chrono::steady_clock::time_point enqueueTime = std::chrono::steady_clock::now();
+
+    CryptoWaiter waiter = { false, 0 };
+    cryptoQueues[caller].push_back(&waiter);
+    grantWorkers();
+    while (!waiter.granted)
+        cryptoCondition.wait(lock);
+    currentWorker = waiter.worker;
+
+    uint64_t waitUs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - enqueueTime).count();
+    cryptoStats[caller].served++;
+    cryptoStats[caller].totalWaitUs += waitUs;
+    if (waitUs > cryptoStats[caller].maxWaitUs)
+        cryptoStats[caller].maxWaitUs = waitUs;
+}
+
+void releaseCryptoWorker() {
+    std::unique_lock<std::mutex> lock(cryptoMutex);
+    if (currentWorker == NO_WORKER)
+        return;
+    busyWorkers[currentWorker] = false;
+    currentWorker = NO_WORKER;
+    releasedWorkers++;
+    bool printStats = !(releasedWorkers % CRYPTO_STATS_PERIOD);
+    grantWorkers();
+    lock.unlock();
+
+    if (printStats)
+        printCryptoStats();
+}
+
+uint32_t getCryptoWorker() {
+    //Initialization runs before workers are started and uses the first context
+    return (currentWorker != NO_WORKER) ? currentWorker : 0;
+}
+
+void printCryptoStats() {
+    std::lock_guard<std::mutex> lock(cryptoMutex);
+    for (int i = 0; i < CRYPTO_CALLER_NUMBER; i++) {
+        CryptoCallerStats &stats = cryptoStats[i];
+        uint64_t averageWaitUs = stats.served ? (stats.totalWaitUs / stats.served) : 0;
+        fprintf(stderr, "[%s] Info: Crypto caller '%s': served %u, average wait %" PRIu64 " us, max wait %" PRIu64 " us\n",
+            ENTITY_NAME, cryptoCallerNames[i], stats.served, averageWaitUs, stats.maxWaitUs);
+    }
+}
\ No newline at end of file
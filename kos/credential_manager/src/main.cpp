@@ -1,29 +1,25 @@
 #include "../include/credential_manager.h"
 #include "../include/credential_manager_interface.h"
+#include "../include/crypto_scheduler.h"
+#ifdef SESSION_AUTHENTICATION
+#include "../include/session_key.h"
+#endif
 #include "../../shared/include/initialization_interface.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <thread>
 
 #define NK_USE_UNQUALIFIED_NAMES
 #include <drone_controller/CredentialManager.edl.h>
 
-int main(void) {
-    if (!getRsaKey())
-        return EXIT_FAILURE;
-
-    if (!shareRsaKey())
-        return EXIT_FAILURE;
+//One receiving thread per entity that signs messages, and a spare one
+#define CREDENTIAL_MANAGER_THREADS (CRYPTO_CALLER_NUMBER + 1)
 
-    fprintf(stderr, "[%s] Info: Initialization is finished\n", ENTITY_NAME);
-
-    NkKosTransport transport;
-    initReceiverInterface("credential_manager_connection", transport);
-
-    CredentialManager_entity entity;
-    CredentialManager_entity_init(&entity, CreateInitializationImpl(), CreateCredentialManagerInterfaceImpl());
+std::thread receiverThreads[CREDENTIAL_MANAGER_THREADS - 1];
 
+void serveRequests(NkKosTransport* transport, CredentialManager_entity* entity) {
     CredentialManager_entity_req req;
     CredentialManager_entity_res res;
     char reqBuffer[CredentialManager_entity_req_arena_size];
@@ -35,14 +31,45 @@ int main(void) {
         nk_req_reset(&req);
         nk_arena_reset(&reqArena);
         nk_arena_reset(&resArena);
-        if (nk_transport_recv(&transport.base, &req.base_, &reqArena) == NK_EOK) {
-            CredentialManager_entity_dispatch(&entity, &req.base_, &reqArena, &res.base_, &resArena);
-            if (nk_transport_reply(&transport.base, &res.base_, &resArena) != NK_EOK)
+        if (nk_transport_recv(&transport->base, &req.base_, &reqArena) == NK_EOK) {
+            CredentialManager_entity_dispatch(entity, &req.base_, &reqArena, &res.base_, &resArena);
+            if (nk_transport_reply(&transport->base, &res.base_, &resArena) != NK_EOK)
                 fprintf(stderr, "[%s] Warning: Failed to send a reply to IPC-message\n", ENTITY_NAME);
         }
         else
             fprintf(stderr, "[%s] Warning: Failed to receive IPC-message\n", ENTITY_NAME);
     };
+}
+
+int main(void) {
+    if (!getRsaKey() || !getEcdsaKey())
+        return EXIT_FAILURE;
+
+    if (!shareRsaKey())
+        return EXIT_FAILURE;
+
+#ifdef SESSION_AUTHENTICATION
+    if (!openSession())
+        fprintf(stderr, "[%s] Warning: Failed to open session, messages are signed with RSA\n", ENTITY_NAME);
+#endif
+
+    fprintf(stderr, "[%s] Info: Initialization is finished\n", ENTITY_NAME);
+
+#ifdef RSA_KEY_PREGENERATION
+    //Spare key is generated while requests are served, so a start after the key is lost does not wait for it
+    startRsaKeyPregeneration();
+#endif
+
+    NkKosTransport transport;
+    initReceiverInterface("credential_manager_connection", transport);
+
+    CredentialManager_entity entity;
+    CredentialManager_entity_init(&entity, CreateInitializationImpl(), CreateCredentialManagerInterfaceImpl());
+
+    //Requests are received in parallel, crypto operations are shared between callers by the crypto scheduler
+    for (int i = 0; i < CREDENTIAL_MANAGER_THREADS - 1; i++)
+        receiverThreads[i] = std::thread(serveRequests, &transport, &entity);
+    serveRequests(&transport, &entity);
 
     return EXIT_SUCCESS;
 }
\ No newline at end of file
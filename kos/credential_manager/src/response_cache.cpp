@@ -0,0 +1,138 @@
+#include "../include/response_cache.h"
+
+#include <mbedtls_v3/sha256.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <mutex>
+
+#define RESPONSE_CACHE_BUCKETS (2 * RESPONSE_CACHE_SIZE)
+#define RESPONSE_CACHE_STATS_PERIOD 500
+#define NO_RESPONSE -1
+
+struct CachedResponse {
+    uint8_t digest[32];
+    int32_t older;
+    int32_t newer;
+    int32_t nextInBucket;
+};
+
+std::mutex cacheMutex;
+CachedResponse cachedResponses[RESPONSE_CACHE_SIZE];
+int32_t cacheBuckets[RESPONSE_CACHE_BUCKETS];
+int32_t newestResponse = NO_RESPONSE;
+int32_t oldestResponse = NO_RESPONSE;
+uint32_t cachedResponseNumber = 0;
+bool cacheInitialized = false;
+uint32_t checkedResponses = 0;
+uint32_t cacheHits = 0;
+
+uint32_t getBucket(uint8_t* digest) {
+    return (digest[0] | (digest[1] << 8) | (digest[2] << 16) | ((uint32_t)digest[3] << 24)) % RESPONSE_CACHE_BUCKETS;
+}
+
+void resetCache() {
+    for (int i = 0; i < RESPONSE_CACHE_BUCKETS; i++)
+        cacheBuckets[i] = NO_RESPONSE;
+    newestResponse = NO_RESPONSE;
+    oldestResponse = NO_RESPONSE;
+    cachedResponseNumber = 0;
+    cacheInitialized = true;
+}
+
+void unlinkResponse(int32_t index) {
+    CachedResponse &response = cachedResponses[index];
+    if (response.older != NO_RESPONSE)
+        cachedResponses[response.older].newer = response.newer;
+    else
+        oldestResponse = response.newer;
+    if (response.newer != NO_RESPONSE)
+        cachedResponses[response.newer].older = response.older;
+    else
+        newestResponse = response.older;
+}
+
+void linkNewestResponse(int32_t index) {
+    cachedResponses[index].older = newestResponse;
+    cachedResponses[index].newer = NO_RESPONSE;
+    if (newestResponse != NO_RESPONSE)
+        cachedResponses[newestResponse].newer = index;
+    else
+        oldestResponse = index;
+    newestResponse = index;
+}
+
+void removeFromBucket(int32_t index) {
+    int32_t* link = &cacheBuckets[getBucket(cachedResponses[index].digest)];
+    while (*link != NO_RESPONSE) {
+        if (*link == index) {
+            *link = cachedResponses[index].nextInBucket;
+            return;
+        }
+        link = &cachedResponses[*link].nextInBucket;
+    }
+}
+
+int32_t findResponse(uint8_t* digest) {
+    for (int32_t i = cacheBuckets[getBucket(digest)]; i != NO_RESPONSE; i = cachedResponses[i].nextInBucket)
+        if (!memcmp(cachedResponses[i].digest, digest, 32))
+            return i;
+    return NO_RESPONSE;
+}
+
+int findVerifiedResponse(char* response, uint8_t* digest, uint8_t &found) {
+    found = 0;
+    if (mbedtls_sha256((unsigned char*)response, strlen(response), digest, 0) != 0) {
+        fprintf(stderr, "[%s] Warning: Failed to calculate hash of received message\n", ENTITY_NAME);
+        return 0;
+    }
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    if (!cacheInitialized)
+        resetCache();
+    int32_t index = findResponse(digest);
+    if (index != NO_RESPONSE) {
+        unlinkResponse(index);
+        linkNewestResponse(index);
+        found = 1;
+        cacheHits++;
+    }
+
+    checkedResponses++;
+    if (checkedResponses == RESPONSE_CACHE_STATS_PERIOD) {
+        fprintf(stderr, "[%s] Info: %u of %u server responses were verified from cache\n", ENTITY_NAME, cacheHits, checkedResponses);
+        checkedResponses = 0;
+        cacheHits = 0;
+    }
+
+    return 1;
+}
+
+void storeVerifiedResponse(uint8_t* digest) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    if (!cacheInitialized)
+        resetCache();
+    if (findResponse(digest) != NO_RESPONSE)
+        return;
+
+    //Least recently used response is replaced when the cache is full
+    int32_t index;
+    if (cachedResponseNumber < RESPONSE_CACHE_SIZE)
+        index = cachedResponseNumber++;
+    else {
+        index = oldestResponse;
+        unlinkResponse(index);
+        removeFromBucket(index);
+    }
+
+    memcpy(cachedResponses[index].digest, digest, 32);
+    uint32_t bucket = getBucket(digest);
+    cachedResponses[index].nextInBucket = cacheBuckets[bucket];
+    cacheBuckets[bucket] = index;
+    linkNewestResponse(index);
+}
+
+void clearResponseCache() {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    resetCache();
+}
\ No newline at end of file
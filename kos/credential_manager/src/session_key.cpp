@@ -0,0 +1,229 @@
+#include "../include/session_key.h"
+#include "../include/credential_manager.h"
+#include "../../shared/include/hex_codec.h"
+#include "../../shared/include/ipc_messages_server_connector.h"
+
+#include <mbedtls_v3/md.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+#define SESSION_KEY_MAX_MESSAGES 1000000
+#define SESSION_RETRY_PERIOD_S 60
+#define SESSION_REPLAY_WINDOW 64
+
+struct SessionKey {
+    bool valid;
+    uint32_t epoch;
+    uint8_t key[SESSION_KEY_SIZE];
+    uint64_t sentCounter;
+    uint64_t receivedCounter;
+    uint64_t receivedWindow;
+};
+
+std::mutex sessionMutex;
+//Previous key is kept to check responses to requests that were signed before rotation
+SessionKey sessionKeys[2];
+uint32_t currentSessionKey = 0;
+std::chrono::steady_clock::time_point sessionOpenTime;
+std::chrono::steady_clock::time_point sessionAttemptTime;
+bool sessionAttempted = false;
+bool sessionOpening = false;
+
+int calculateSessionMac(uint8_t* key, char direction, uint32_t epoch, uint64_t counter, char* message, uint32_t messageLength, char* mac) {
+    uint8_t header[13] = {0};
+    header[0] = direction;
+    for (int i = 0; i < 4; i++)
+        header[1 + i] = (epoch >> (24 - 8 * i)) & 0xFF;
+    for (int i = 0; i < 8; i++)
+        header[5 + i] = (counter >> (56 - 8 * i)) & 0xFF;
+
+    uint8_t digest[32] = {0};
+    mbedtls_md_context_t md;
+    mbedtls_md_init(&md);
+    int result = (mbedtls_md_setup(&md, mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), 1) == 0)
+        && (mbedtls_md_hmac_starts(&md, key, SESSION_KEY_SIZE) == 0) && (mbedtls_md_hmac_update(&md, header, sizeof(header)) == 0)
+        && (mbedtls_md_hmac_update(&md, (unsigned char*)message, messageLength) == 0) && (mbedtls_md_hmac_finish(&md, digest) == 0);
+    mbedtls_md_free(&md);
+    if (!result) {
+        fprintf(stderr, "[%s] Warning: Failed to calculate message HMAC\n", ENTITY_NAME);
+        return 0;
+    }
+
+    bytesToHex(digest, sizeof(digest), mac);
+    return 1;
+}
+
+int acceptCounter(SessionKey &session, uint64_t counter) {
+    //Responses to parallel requests can arrive out of order, so replays are tracked in a window
+    if (counter > session.receivedCounter) {
+        uint64_t shift = counter - session.receivedCounter;
+        session.receivedWindow = (shift < SESSION_REPLAY_WINDOW) ? ((session.receivedWindow << shift) | 1) : 1;
+        session.receivedCounter = counter;
+        return 1;
+    }
+    uint64_t offset = session.receivedCounter - counter;
+    if ((offset >= SESSION_REPLAY_WINDOW) || ((session.receivedWindow >> offset) & 1))
+        return 0;
+    session.receivedWindow |= ((uint64_t)1 << offset);
+    return 1;
+}
+
+int openSession() {
+    char request[1024] = {0};
+    char signature[RSA_KEY_STRING_SIZE] = {0};
+    char response[1024] = {0};
+    snprintf(request, 1024, "/api/session?%s", BOARD_ID);
+    if (!signRsaMessage(request, signature))
+        return 0;
+    uint32_t requestLength = strlen(request);
+    snprintf(request + requestLength, 1024 - requestLength, "&sig=0x%s", signature);
+
+    if (!sendRequest(request, response)) {
+        fprintf(stderr, "[%s] Warning: Failed to open session at the server\n", ENTITY_NAME);
+        return 0;
+    }
+    uint8_t authenticity = 0;
+    if (!checkSignature(response, authenticity) || !authenticity)
+        return 0;
+
+    char header[] = "$Session: ";
+    char* epochStart = strstr(response, header);
+    char* keyStart = NULL;
+    char* keyEnd = strstr(response, "#");
+    uint32_t epoch = 0;
+    if (epochStart != NULL)
+        epoch = strtoul(epochStart + strlen(header), &keyStart, 16);
+    if ((epochStart == NULL) || !epoch || (keyEnd == NULL) || (*keyStart != ' ') || (keyEnd <= keyStart)) {
+        fprintf(stderr, "[%s] Warning: Failed to parse session key received from the server\n", ENTITY_NAME);
+        return 0;
+    }
+    keyStart++;
+
+    uint8_t encrypted[RSA_KEY_BYTES] = {0};
+    uint8_t decrypted[RSA_KEY_BYTES] = {0};
+    stringToBytes(keyStart, keyEnd - keyStart, encrypted, RSA_KEY_BYTES);
+    if (!decryptMessage(encrypted, decrypted))
+        return 0;
+    for (int i = 0; i < RSA_KEY_BYTES - SESSION_KEY_SIZE; i++)
+        if (decrypted[i]) {
+            fprintf(stderr, "[%s] Warning: Session key received from the server is corrupted\n", ENTITY_NAME);
+            return 0;
+        }
+
+    std::lock_guard<std::mutex> lock(sessionMutex);
+    currentSessionKey = 1 - currentSessionKey;
+    SessionKey &session = sessionKeys[currentSessionKey];
+    session.valid = true;
+    session.epoch = epoch;
+    memcpy(session.key, decrypted + RSA_KEY_BYTES - SESSION_KEY_SIZE, SESSION_KEY_SIZE);
+    session.sentCounter = 0;
+    session.receivedCounter = 0;
+    session.receivedWindow = 0;
+    sessionOpenTime = std::chrono::steady_clock::now();
+    fprintf(stderr, "[%s] Info: Session key %u is received\n", ENTITY_NAME, epoch);
+
+    return 1;
+}
+
+void closeSession() {
+    std::lock_guard<std::mutex> lock(sessionMutex);
+    if (sessionKeys[currentSessionKey].valid)
+        fprintf(stderr, "[%s] Warning: Session is closed by the server\n", ENTITY_NAME);
+    sessionKeys[0].valid = false;
+    sessionKeys[1].valid = false;
+}
+
+void rotateSession() {
+    openSession();
+    std::lock_guard<std::mutex> lock(sessionMutex);
+    sessionOpening = false;
+}
+
+int signSessionMessage(char* message, char* sign) {
+    std::unique_lock<std::mutex> lock(sessionMutex);
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    SessionKey* session = &sessionKeys[currentSessionKey];
+    if (!session->valid || (session->sentCounter >= SESSION_KEY_MAX_MESSAGES)
+        || (now - sessionOpenTime >= std::chrono::seconds(SESSION_KEY_LIFETIME_S))) {
+        //Session is opened in the background, so the crypto worker does not wait for the server round trip.
+        //Server keeps the previous key until the new one is used, so messages are signed with it meanwhile.
+        //Server without session support is not asked again on every message
+        if (!sessionOpening && !(sessionAttempted && (now - sessionAttemptTime < std::chrono::seconds(SESSION_RETRY_PERIOD_S)))) {
+            sessionOpening = true;
+            sessionAttempted = true;
+            sessionAttemptTime = now;
+            std::thread(rotateSession).detach();
+        }
+        if (!session->valid)
+            return 0;
+    }
+
+    uint32_t epoch = session->epoch;
+    uint64_t counter = ++session->sentCounter;
+    uint8_t key[SESSION_KEY_SIZE];
+    memcpy(key, session->key, SESSION_KEY_SIZE);
+    lock.unlock();
+
+    char mac[65] = {0};
+    if (!calculateSessionMac(key, 'D', epoch, counter, message, strlen(message), mac))
+        return 0;
+    snprintf(sign, SESSION_TOKEN_LENGTH + 1, "%08x%016llx%s", epoch, (unsigned long long)counter, mac);
+
+    return 1;
+}
+
+int isSessionToken(char* token) {
+    if (strlen(token) != SESSION_TOKEN_LENGTH)
+        return 0;
+    std::lock_guard<std::mutex> lock(sessionMutex);
+    return sessionKeys[0].valid || sessionKeys[1].valid;
+}
+
+int checkSessionMessage(char* message, uint32_t messageLength, char* token, uint8_t &correct) {
+    correct = 0;
+
+    char epochString[9] = {0};
+    char counterString[17] = {0};
+    memcpy(epochString, token, 8);
+    memcpy(counterString, token + 8, 16);
+    uint32_t epoch = strtoul(epochString, NULL, 16);
+    uint64_t counter = strtoull(counterString, NULL, 16);
+
+    std::unique_lock<std::mutex> lock(sessionMutex);
+    int index = -1;
+    for (int i = 0; i < 2; i++)
+        if (sessionKeys[i].valid && (sessionKeys[i].epoch == epoch))
+            index = i;
+    if (index == -1) {
+        fprintf(stderr, "[%s] Warning: Message is signed with unknown session key\n", ENTITY_NAME);
+        return 0;
+    }
+    uint8_t key[SESSION_KEY_SIZE];
+    memcpy(key, sessionKeys[index].key, SESSION_KEY_SIZE);
+    lock.unlock();
+
+    char mac[65] = {0};
+    if (!calculateSessionMac(key, 'S', epoch, counter, message, messageLength, mac))
+        return 0;
+    uint8_t difference = 0;
+    for (int i = 0; i < 64; i++)
+        difference |= mac[i] ^ token[24 + i];
+    if (difference) {
+        fprintf(stderr, "[%s] Warning: Authenticity is not confirmed\n", ENTITY_NAME);
+        return 0;
+    }
+
+    lock.lock();
+    if (!sessionKeys[index].valid || (sessionKeys[index].epoch != epoch) || !acceptCounter(sessionKeys[index], counter)) {
+        fprintf(stderr, "[%s] Warning: Replayed message is rejected\n", ENTITY_NAME);
+        return 0;
+    }
+
+    correct = 1;
+    return 1;
+}
\ No newline at end of file
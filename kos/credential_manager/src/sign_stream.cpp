@@ -0,0 +1,126 @@
+#include "../include/sign_stream.h"
+
+#include <mbedtls_v3/sha256.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <mutex>
+
+//Stream number holds the slot in low bits and the number of its opening in the rest, so a stale number is not accepted
+#define SIGN_STREAM_SLOT_BITS 8
+#define SIGN_STREAM_SLOT_MASK ((1 << SIGN_STREAM_SLOT_BITS) - 1)
+//Message start is kept to recognize the caller, it is never longer than caller prefixes
+#define SIGN_STREAM_PREFIX_SIZE 32
+
+struct SignStream {
+    bool active;
+    uint32_t number;
+    uint64_t size;
+    char prefix[SIGN_STREAM_PREFIX_SIZE];
+    std::chrono::steady_clock::time_point lastUpdate;
+    mbedtls_sha256_context sha256;
+};
+
+std::mutex streamMutex;
+SignStream signStreams[SIGN_STREAMS];
+uint32_t openedStreams = 0;
+
+SignStream* findSignStream(uint32_t stream) {
+    uint32_t slot = stream & SIGN_STREAM_SLOT_MASK;
+    if ((slot >= SIGN_STREAMS) || !signStreams[slot].active || (signStreams[slot].number != stream)) {
+        fprintf(stderr, "[%s] Warning: Sign stream %u is not open\n", ENTITY_NAME, stream);
+        return NULL;
+    }
+    return &signStreams[slot];
+}
+
+void closeSignStream(SignStream* signStream) {
+    mbedtls_sha256_free(&signStream->sha256);
+    signStream->active = false;
+}
+
+int beginSignStream(uint32_t &stream) {
+    std::lock_guard<std::mutex> lock(streamMutex);
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    int slot = -1;
+    for (int i = 0; i < SIGN_STREAMS; i++) {
+        if (signStreams[i].active && (now - signStreams[i].lastUpdate >= std::chrono::seconds(SIGN_STREAM_TIMEOUT_S))) {
+            fprintf(stderr, "[%s] Warning: Sign stream %u is abandoned after %llu bytes\n", ENTITY_NAME,
+                signStreams[i].number, (unsigned long long)signStreams[i].size);
+            closeSignStream(&signStreams[i]);
+        }
+        if (!signStreams[i].active && (slot == -1))
+            slot = i;
+    }
+    if (slot == -1) {
+        fprintf(stderr, "[%s] Warning: All %d sign streams are busy\n", ENTITY_NAME, SIGN_STREAMS);
+        return 0;
+    }
+
+    SignStream &signStream = signStreams[slot];
+    mbedtls_sha256_init(&signStream.sha256);
+    if (mbedtls_sha256_starts(&signStream.sha256, 0) != 0) {
+        fprintf(stderr, "[%s] Warning: Failed to calculate message hash\n", ENTITY_NAME);
+        mbedtls_sha256_free(&signStream.sha256);
+        return 0;
+    }
+    signStream.active = true;
+    signStream.number = (++openedStreams << SIGN_STREAM_SLOT_BITS) | slot;
+    signStream.size = 0;
+    signStream.prefix[0] = '\0';
+    signStream.lastUpdate = now;
+
+    stream = signStream.number;
+    return 1;
+}
+
+int updateSignStream(uint32_t stream, uint8_t* chunk, uint32_t chunkSize) {
+    std::lock_guard<std::mutex> lock(streamMutex);
+    SignStream* signStream = findSignStream(stream);
+    if (signStream == NULL)
+        return 0;
+
+    if (mbedtls_sha256_update(&signStream->sha256, chunk, chunkSize) != 0) {
+        fprintf(stderr, "[%s] Warning: Failed to calculate message hash\n", ENTITY_NAME);
+        closeSignStream(signStream);
+        return 0;
+    }
+    if (signStream->size < SIGN_STREAM_PREFIX_SIZE - 1) {
+        uint32_t prefixSize = SIGN_STREAM_PREFIX_SIZE - 1 - signStream->size;
+        if (prefixSize > chunkSize)
+            prefixSize = chunkSize;
+        memcpy(signStream->prefix + signStream->size, chunk, prefixSize);
+        signStream->prefix[signStream->size + prefixSize] = '\0';
+    }
+    signStream->size += chunkSize;
+    signStream->lastUpdate = std::chrono::steady_clock::now();
+
+    return 1;
+}
+
+int finishSignStream(uint32_t stream, uint8_t* hash, CryptoCaller &caller) {
+    std::lock_guard<std::mutex> lock(streamMutex);
+    SignStream* signStream = findSignStream(stream);
+    if (signStream == NULL)
+        return 0;
+
+    int result = (mbedtls_sha256_finish(&signStream->sha256, hash) == 0);
+    if (!result)
+        fprintf(stderr, "[%s] Warning: Failed to calculate message hash\n", ENTITY_NAME);
+    caller = classifyCryptoRequest(signStream->prefix);
+    closeSignStream(signStream);
+
+    return result;
+}
+
+int cancelSignStream(uint32_t stream) {
+    std::lock_guard<std::mutex> lock(streamMutex);
+    SignStream* signStream = findSignStream(stream);
+    if (signStream == NULL)
+        return 0;
+
+    closeSignStream(signStream);
+
+    return 1;
+}
\ No newline at end of file
@@ -0,0 +1,95 @@
+#include "../include/telemetry_tree.h"
+#include "../../shared/include/hex_codec.h"
+
+#include <mbedtls_v3/sha256.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <mutex>
+
+//Leaves and nodes are hashed with different prefixes as in RFC 6962, so a node cannot be passed off as a sample
+#define TREE_LEAF_PREFIX 0x00
+#define TREE_NODE_PREFIX 0x01
+
+std::mutex treeMutex;
+uint8_t leafHashes[TELEMETRY_TREE_SAMPLES][32];
+uint32_t leafNumber = 0;
+uint32_t telemetryBatch = 0;
+bool pendingLeaf = false;
+std::chrono::steady_clock::time_point batchStart;
+
+int hashTreeData(uint8_t prefix, const uint8_t* first, uint32_t firstSize, const uint8_t* second, uint32_t secondSize,
+    uint8_t* hash) {
+    mbedtls_sha256_context sha256;
+    mbedtls_sha256_init(&sha256);
+    int result = (mbedtls_sha256_starts(&sha256, 0) == 0) && (mbedtls_sha256_update(&sha256, &prefix, 1) == 0)
+        && (mbedtls_sha256_update(&sha256, first, firstSize) == 0) && (mbedtls_sha256_update(&sha256, second, secondSize) == 0)
+        && (mbedtls_sha256_finish(&sha256, hash) == 0);
+    mbedtls_sha256_free(&sha256);
+    if (!result)
+        fprintf(stderr, "[%s] Warning: Failed to calculate telemetry tree hash\n", ENTITY_NAME);
+    return result;
+}
+
+//Leaves are split at the largest power of two below their number, so a tree can be built over any number of samples
+int calculateTreeRoot(uint8_t (*leaves)[32], uint32_t number, uint8_t* root) {
+    if (number == 1) {
+        memcpy(root, leaves[0], 32);
+        return 1;
+    }
+    uint32_t split = 1;
+    while (2 * split < number)
+        split *= 2;
+    uint8_t left[32], right[32];
+    return calculateTreeRoot(leaves, split, left) && calculateTreeRoot(leaves + split, number - split, right)
+        && hashTreeData(TREE_NODE_PREFIX, left, 32, right, 32, root);
+}
+
+//Sample is added as a pending leaf, the next one replaces it until it is confirmed to be received by the server
+int appendTelemetrySample(char* sample, uint32_t &batch, uint32_t &index) {
+    std::lock_guard<std::mutex> lock(treeMutex);
+    if (!hashTreeData(TREE_LEAF_PREFIX, (uint8_t*)sample, strlen(sample), NULL, 0, leafHashes[leafNumber]))
+        return 0;
+    batch = telemetryBatch;
+    index = leafNumber;
+    pendingLeaf = true;
+
+    return 1;
+}
+
+//Root hash is the hash of the root message, which is signed instead of every sample
+int confirmTelemetrySample(uint32_t batch, uint32_t index, char* root, uint32_t rootSize, uint8_t* rootHash) {
+    std::lock_guard<std::mutex> lock(treeMutex);
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    root[0] = '\0';
+    if (!pendingLeaf || (batch != telemetryBatch) || (index != leafNumber)) {
+        fprintf(stderr, "[%s] Warning: Confirmed telemetry sample %u of batch %u is not pending\n", ENTITY_NAME, index, batch);
+        return 0;
+    }
+    pendingLeaf = false;
+    if (!leafNumber)
+        batchStart = now;
+    leafNumber++;
+
+    if ((leafNumber < TELEMETRY_TREE_SAMPLES) && (now - batchStart < std::chrono::seconds(TELEMETRY_TREE_PERIOD_S)))
+        return 1;
+
+    //Batch is closed, the root message is signed and sent instead of every sample
+    uint8_t treeRoot[32] = {0};
+    char rootHex[65] = {0};
+    uint32_t count = leafNumber;
+    telemetryBatch++;
+    leafNumber = 0;
+    if (!calculateTreeRoot(leafHashes, count, treeRoot))
+        return 0;
+    bytesToHex(treeRoot, 32, rootHex);
+    snprintf(root, rootSize, "/api/telemetry_root?%s&batch=%u&count=%u&root=%s", BOARD_ID, batch, count, rootHex);
+    if (mbedtls_sha256((unsigned char*)root, strlen(root), rootHash, 0) != 0) {
+        fprintf(stderr, "[%s] Warning: Failed to calculate telemetry root message hash\n", ENTITY_NAME);
+        root[0] = '\0';
+        return 0;
+    }
+
+    return 1;
+}
\ No newline at end of file
@@ -0,0 +1,148 @@
+#include "../include/bmp280.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <vector>
+
+#define DEFAULT_BATCHES 200
+#define BATCH_SIZE 1000
+#define SAMPLE_NUMBER 1024
+
+//Calibration and readings of the compensation example in the BMP280 datasheet
+const Bmp280Calibration datasheetCalibration = { { 27504, 26435, -1000 },
+    { 36477, -10685, 3024, 2855, 140, -7, 15500, -14600, 6000 } };
+const int32_t datasheetTemperature = 519888;
+const int32_t datasheetPressure = 415148;
+
+volatile int32_t sink;
+
+//Double precision compensation used by Navigation System before, it is the datasheet reference as well
+double legacyTemperatureFine;
+
+double legacyGetTemperature(const Bmp280Calibration &calibration, int32_t temp) {
+    const int32_t* tempCoefs = calibration.temperature;
+    double tempFst = (temp / 16384.0 - tempCoefs[0] / 1024.0) * tempCoefs[1];
+    double tempSnd = pow(temp / 131072.0 - tempCoefs[0] / 8192.0, 2) * tempCoefs[2];
+    legacyTemperatureFine = tempFst + tempSnd;
+    return legacyTemperatureFine / 5120.0;
+}
+
+double legacyGetPressure(const Bmp280Calibration &calibration, int32_t press) {
+    const int32_t* pressCoefs = calibration.pressure;
+    double pressFst = (legacyTemperatureFine / 2.0) - 64000.0;
+    double pressSnd = pow(pressFst, 2) * pressCoefs[5] / 32768.0;
+    pressSnd += pressFst * pressCoefs[4] * 2.0;
+    pressSnd = (pressSnd / 4.0) + (pressCoefs[3] * 65536.0);
+    pressFst = (pressCoefs[2] * pow(pressFst, 2) / 524288.0 + pressFst * pressCoefs[1]) / 524288.0;
+    pressFst = (1.0 + pressFst / 32768.0) * pressCoefs[0];
+
+    double pressTrd = 1048576.0 - press;
+    pressTrd = (pressTrd - (pressSnd / 4096.0)) * 6250.0 / pressFst;
+    pressFst = pressCoefs[8] * pow(pressTrd, 2) / 2147483648.0;
+    pressSnd = pressTrd * pressCoefs[7] / 32768.0;
+    return pressTrd + (pressFst + pressSnd + pressCoefs[6]) / 16.0;
+}
+
+int32_t legacyGetAltitude(const Bmp280Calibration &calibration, int32_t temp, int32_t press) {
+    legacyGetTemperature(calibration, temp);
+    float pressure = legacyGetPressure(calibration, press);
+    float alt = 44330.0 * (1.0 - pow(pressure / 101325.0, 0.1903));
+    return 100 * alt;
+}
+
+int32_t getAltitude(const Bmp280Calibration &calibration, int32_t temp, int32_t press) {
+    int32_t fineTemperature;
+    compensateBmp280Temperature(calibration, temp, fineTemperature);
+    return pressureToAltitude(compensateBmp280Pressure(calibration, press, fineTemperature));
+}
+
+void printHeader() {
+    fprintf(stdout, "operation,implementation,calls,calls_per_sec,mean_ns,p50_ns,p90_ns,p99_ns,max_ns\n");
+}
+
+void measure(const char* operation, const char* implementation, int batches, std::function<void(uint32_t)> call) {
+    std::vector<double> latencies;
+    for (int i = 0; i < batches; i++) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (int j = 0; j < BATCH_SIZE; j++)
+            call(j % SAMPLE_NUMBER);
+        latencies.push_back(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / BATCH_SIZE);
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    size_t size = latencies.size();
+    double total = 0;
+    for (double latency : latencies)
+        total += latency;
+    fprintf(stdout, "%s,%s,%zu,%.0f,%.1f,%.1f,%.1f,%.1f,%.1f\n", operation, implementation, size * BATCH_SIZE,
+        1000000000.0 * size / total, total / size, latencies[size / 2], latencies[(size * 90) / 100], latencies[(size * 99) / 100],
+        latencies[size - 1]);
+}
+
+int main(int argc, char** argv) {
+    int batches = DEFAULT_BATCHES;
+    bool header = true;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--no-header"))
+            header = false;
+        else
+            batches = atoi(argv[i]);
+    }
+    if (batches <= 0) {
+        fprintf(stderr, "Usage: %s [batches] [--no-header]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    initAltitudeTable();
+    const Bmp280Calibration &calibration = datasheetCalibration;
+    int32_t fineTemperature;
+    int32_t temperature = compensateBmp280Temperature(calibration, datasheetTemperature, fineTemperature);
+    uint32_t pressure = compensateBmp280Pressure(calibration, datasheetPressure, fineTemperature);
+    fprintf(stderr, "Datasheet example: %.2f C, %.2f Pa (datasheet gives 25.08 C, 100653.27 Pa)\n", temperature / 100.0, pressure / 256.0);
+    if ((temperature != 2508) || (fabs(pressure / 256.0 - 100653.27) > 0.05)) {
+        fprintf(stderr, "Integer compensation does not match the datasheet example\n");
+        return EXIT_FAILURE;
+    }
+
+    //Errors are checked on raw readings from -20 to 60 C and on the whole pressure range of the altitude table
+    double maxTemperatureError = 0, maxPressureError = 0, maxAltitudeError = 0;
+    for (int32_t rawTemperature = 400000; rawTemperature <= 640000; rawTemperature += 4000)
+        for (int32_t rawPressure = 250000; rawPressure <= 650000; rawPressure += 1000) {
+            double legacyTemperature = legacyGetTemperature(calibration, rawTemperature);
+            double legacyPressure = legacyGetPressure(calibration, rawPressure);
+            temperature = compensateBmp280Temperature(calibration, rawTemperature, fineTemperature);
+            pressure = compensateBmp280Pressure(calibration, rawPressure, fineTemperature);
+            maxTemperatureError = std::max(maxTemperatureError, fabs(temperature / 100.0 - legacyTemperature));
+            if ((legacyPressure < ALTITUDE_TABLE_MIN_PRESSURE) || (legacyPressure > ALTITUDE_TABLE_MAX_PRESSURE))
+                continue;
+            maxPressureError = std::max(maxPressureError, fabs(pressure / 256.0 - legacyPressure));
+            double legacyAltitude = 100 * 44330.0 * (1.0 - pow(legacyPressure / 101325.0, 0.1903));
+            maxAltitudeError = std::max(maxAltitudeError, fabs(pressureToAltitude(pressure) - legacyAltitude));
+        }
+    fprintf(stderr, "Max errors against double compensation: %.4f C, %.4f Pa, %.2f cm of altitude\n", maxTemperatureError,
+        maxPressureError, maxAltitudeError);
+
+    std::vector<int32_t> rawTemperatures(SAMPLE_NUMBER), rawPressures(SAMPLE_NUMBER);
+    for (int i = 0; i < SAMPLE_NUMBER; i++) {
+        rawTemperatures[i] = 500000 + (i * 37) % 40000;
+        rawPressures[i] = 400000 + (i * 7919) % 100000;
+    }
+
+    if (header)
+        printHeader();
+    measure("temperature", "double", batches, [&](uint32_t i) { sink = legacyGetTemperature(calibration, rawTemperatures[i]); });
+    measure("temperature", "integer", batches, [&](uint32_t i) { sink = compensateBmp280Temperature(calibration, rawTemperatures[i], fineTemperature); });
+    measure("pressure", "double", batches, [&](uint32_t i) { sink = legacyGetPressure(calibration, rawPressures[i]); });
+    measure("pressure", "integer", batches, [&](uint32_t i) { sink = compensateBmp280Pressure(calibration, rawPressures[i], fineTemperature); });
+    measure("altitude", "pow", batches, [&](uint32_t i) { sink = 4433000.0 * (1.0 - pow(rawPressures[i] / 4.0 / 101325.0, 0.1903)); });
+    measure("altitude", "table", batches, [&](uint32_t i) { sink = pressureToAltitude(rawPressures[i] * 64); });
+    measure("sample", "legacy", batches, [&](uint32_t i) { sink = legacyGetAltitude(calibration, rawTemperatures[i], rawPressures[i]); });
+    measure("sample", "integer", batches, [&](uint32_t i) { sink = getAltitude(calibration, rawTemperatures[i], rawPressures[i]); });
+
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
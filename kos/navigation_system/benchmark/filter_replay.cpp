@@ -0,0 +1,264 @@
+#include "../include/navigation_filter.h"
+#include "../include/nmea_parser.h"
+#include "../include/nmea_reader.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#define OUTPUT_PERIOD_US (1000000 / NAVIGATION_FILTER_RATE_HZ)
+//Filtered track may not lag behind GPS more than a second of flight at 8 m/s
+#define MAX_MEAN_OFFSET_M 8.0f
+
+enum ReplayEventType { POSITION_EVENT, VELOCITY_EVENT, ALTITUDE_EVENT };
+
+struct ReplayEvent {
+    uint64_t timeUs;
+    ReplayEventType type;
+    int32_t latitude;
+    int32_t longitude;
+    int32_t altitude;
+    float groundSpeed;
+    float course;
+    float deviation;
+};
+
+struct TrackPoint {
+    double north;
+    double east;
+    double up;
+};
+
+volatile int32_t sink;
+
+int loadNmeaEvents(const char* path, std::vector<ReplayEvent> &events) {
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) {
+        fprintf(stderr, "Failed to open GPS log %s\n", path);
+        return 0;
+    }
+    static NmeaReader reader;
+    initNmeaReader(reader);
+    GpsFix fix;
+    initGpsFix(fix);
+    char sentence[NMEA_MAX_SENTENCE_LENGTH + 1];
+    uint32_t length, freeSize;
+    size_t readBytes;
+    uint8_t* freeSpace = getNmeaWriteSpace(reader, freeSize);
+    while ((readBytes = fread(freeSpace, 1, freeSize, file)) > 0) {
+        commitNmeaWrite(reader, readBytes);
+        while (nextNmeaSentence(reader, sentence, length)) {
+            if (!parseNmeaSentence(sentence, length, fix))
+                continue;
+            ReplayEvent event = { 1000ull * fix.time, POSITION_EVENT, 0, 0, 0, 0.0f, 0.0f, 0.0f };
+            if (fix.updated & GPS_POSITION_UPDATED) {
+                event.type = POSITION_EVENT;
+                event.latitude = fix.latitude;
+                event.longitude = fix.longitude;
+                event.deviation = fix.hdop * NAVIGATION_FILTER_GPS_NOISE;
+                events.push_back(event);
+            }
+            if (fix.updated & GPS_VELOCITY_UPDATED) {
+                event.type = VELOCITY_EVENT;
+                event.groundSpeed = fix.groundSpeed;
+                event.course = fix.course;
+                event.deviation = NAVIGATION_FILTER_VELOCITY_NOISE;
+                events.push_back(event);
+            }
+            fix.updated = 0;
+        }
+        freeSpace = getNmeaWriteSpace(reader, freeSize);
+    }
+    fclose(file);
+    return 1;
+}
+
+int loadBarometerEvents(const char* path, std::vector<ReplayEvent> &events) {
+    FILE* file = fopen(path, "r");
+    if (file == NULL) {
+        fprintf(stderr, "Failed to open barometer log %s\n", path);
+        return 0;
+    }
+    char line[64];
+    while (fgets(line, sizeof(line), file) != NULL) {
+        uint32_t time;
+        int32_t altitude;
+        if (sscanf(line, "%u,%d", &time, &altitude) != 2)
+            continue;
+        ReplayEvent event = { 1000ull * time, ALTITUDE_EVENT, 0, 0, 0, 0.0f, 0.0f, 0.0f };
+        event.altitude = altitude;
+        event.deviation = NAVIGATION_FILTER_BAROMETER_NOISE;
+        events.push_back(event);
+    }
+    fclose(file);
+    return 1;
+}
+
+void applyEvent(NavigationFilter &filter, ReplayEvent &event) {
+    switch (event.type) {
+    case POSITION_EVENT:
+        updateNavigationPosition(filter, event.timeUs, event.latitude, event.longitude, event.deviation);
+        break;
+    case VELOCITY_EVENT:
+        updateNavigationVelocity(filter, event.timeUs, event.groundSpeed, event.course, event.deviation);
+        break;
+    case ALTITUDE_EVENT:
+        updateNavigationAltitude(filter, event.timeUs, event.altitude, event.deviation);
+        break;
+    }
+}
+
+TrackPoint toTrackPoint(int32_t latitude, int32_t longitude, int32_t altitude, int32_t originLatitude, int32_t originLongitude) {
+    double metersPerUnit = 6371000.0 * M_PI / 1800000000.0;
+    TrackPoint point = { (latitude - originLatitude) * metersPerUnit,
+        (longitude - originLongitude) * metersPerUnit * cos(originLatitude * M_PI / 1800000000.0), altitude / 100.0 };
+    return point;
+}
+
+//Raw measurements are held between samples the way getCoords returned them without the filter
+void replay(std::vector<ReplayEvent> &events, std::vector<TrackPoint> &raw, std::vector<TrackPoint> &filtered,
+    std::vector<float> &offsets, std::vector<NavigationSolution> &solutions) {
+    NavigationFilter filter;
+    initNavigationFilter(filter);
+    int32_t rawLatitude = 0, rawLongitude = 0, rawAltitude = 0, originLatitude = 0, originLongitude = 0;
+    bool hasRawPosition = false, hasRawAltitude = false;
+    uint64_t outputTime = events.front().timeUs;
+
+    for (ReplayEvent &event : events) {
+        for (; outputTime < event.timeUs; outputTime += OUTPUT_PERIOD_US) {
+            NavigationSolution solution;
+            predictNavigationFilter(filter, outputTime);
+            if (!hasRawPosition || !hasRawAltitude || !getFilterSolution(filter, solution))
+                continue;
+            solutions.push_back(solution);
+            raw.push_back(toTrackPoint(rawLatitude, rawLongitude, rawAltitude, originLatitude, originLongitude));
+            filtered.push_back(toTrackPoint(solution.latitude, solution.longitude, solution.altitude, originLatitude, originLongitude));
+        }
+
+        applyEvent(filter, event);
+        if (event.type == POSITION_EVENT) {
+            if (!hasRawPosition) {
+                originLatitude = event.latitude;
+                originLongitude = event.longitude;
+            }
+            rawLatitude = event.latitude;
+            rawLongitude = event.longitude;
+            hasRawPosition = true;
+            NavigationSolution solution;
+            if (getFilterSolution(filter, solution)) {
+                TrackPoint gps = toTrackPoint(rawLatitude, rawLongitude, 0, originLatitude, originLongitude);
+                TrackPoint fused = toTrackPoint(solution.latitude, solution.longitude, 0, originLatitude, originLongitude);
+                offsets.push_back(hypot(gps.north - fused.north, gps.east - fused.east));
+            }
+        }
+        else if (event.type == ALTITUDE_EVENT) {
+            rawAltitude = event.altitude;
+            hasRawAltitude = true;
+        }
+    }
+}
+
+//Jitter is the RMS of the second difference, smooth flight has it close to zero
+void printTrackStats(const char* track, std::vector<TrackPoint> &points) {
+    double horizontalJitter = 0, verticalJitter = 0, maxHorizontalStep = 0, maxVerticalStep = 0;
+    for (size_t i = 1; i < points.size(); i++) {
+        maxHorizontalStep = std::max(maxHorizontalStep, hypot(points[i].north - points[i - 1].north, points[i].east - points[i - 1].east));
+        maxVerticalStep = std::max(maxVerticalStep, fabs(points[i].up - points[i - 1].up));
+        if (i < 2)
+            continue;
+        double north = points[i].north - 2 * points[i - 1].north + points[i - 2].north;
+        double east = points[i].east - 2 * points[i - 1].east + points[i - 2].east;
+        double up = points[i].up - 2 * points[i - 1].up + points[i - 2].up;
+        horizontalJitter += north * north + east * east;
+        verticalJitter += up * up;
+    }
+    size_t number = (points.size() > 2) ? (points.size() - 2) : 1;
+    fprintf(stdout, "%s,%zu,%.3f,%.3f,%.3f,%.3f\n", track, points.size(), sqrt(horizontalJitter / number), maxHorizontalStep,
+        sqrt(verticalJitter / number), maxVerticalStep);
+}
+
+int main(int argc, char** argv) {
+    const char* gpsLogPath = NMEA_LOG_PATH;
+    const char* barometerLogPath = BAROMETER_LOG_PATH;
+    const char* trackPath = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (!strncmp(argv[i], "--log=", 6))
+            gpsLogPath = argv[i] + 6;
+        else if (!strncmp(argv[i], "--barometer-log=", 16))
+            barometerLogPath = argv[i] + 16;
+        else if (!strncmp(argv[i], "--track=", 8))
+            trackPath = argv[i] + 8;
+        else {
+            fprintf(stderr, "Usage: %s [--log=<recorded NMEA output>] [--barometer-log=<time_ms,altitude_cm CSV>] [--track=<output CSV>]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::vector<ReplayEvent> events;
+    if (!loadNmeaEvents(gpsLogPath, events) || !loadBarometerEvents(barometerLogPath, events))
+        return EXIT_FAILURE;
+    std::stable_sort(events.begin(), events.end(), [](const ReplayEvent &first, const ReplayEvent &second) { return first.timeUs < second.timeUs; });
+    if (events.empty()) {
+        fprintf(stderr, "Logs have no measurements\n");
+        return EXIT_FAILURE;
+    }
+
+    std::vector<TrackPoint> raw, filtered;
+    std::vector<float> offsets;
+    std::vector<NavigationSolution> solutions;
+    replay(events, raw, filtered, offsets, solutions);
+    if (solutions.empty()) {
+        fprintf(stderr, "Filter gave no solution\n");
+        return EXIT_FAILURE;
+    }
+
+    fprintf(stdout, "track,points,horizontal_jitter_m,max_horizontal_step_m,vertical_jitter_m,max_vertical_step_m\n");
+    printTrackStats("raw", raw);
+    printTrackStats("filtered", filtered);
+
+    double meanOffset = 0;
+    for (float offset : offsets)
+        meanOffset += offset;
+    meanOffset /= offsets.size();
+    NavigationSolution &last = solutions.back();
+    fprintf(stderr, "Mean offset from GPS fixes %.2f m, final position deviation %.2f m, velocity deviation %.2f m/s\n", meanOffset,
+        sqrt(last.positionVariance[0] + last.positionVariance[1]), sqrt(last.velocityVariance[0] + last.velocityVariance[1]));
+
+    //Whole replay is repeated to time one measurement or prediction step
+    int repeats = 100;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i = 0; i < repeats; i++) {
+        NavigationFilter filter;
+        initNavigationFilter(filter);
+        for (ReplayEvent &event : events)
+            applyEvent(filter, event);
+        NavigationSolution solution;
+        getFilterSolution(filter, solution);
+        sink = solution.latitude;
+    }
+    fprintf(stderr, "Filter step takes %.1f ns\n", std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / (repeats * events.size()));
+
+    if (trackPath != NULL) {
+        FILE* file = fopen(trackPath, "w");
+        if (file == NULL) {
+            fprintf(stderr, "Failed to write track %s\n", trackPath);
+            return EXIT_FAILURE;
+        }
+        fprintf(file, "time_us,lat,lon,alt,velocity_north,velocity_east,velocity_up,north_variance,east_variance,up_variance\n");
+        for (NavigationSolution &solution : solutions)
+            fprintf(file, "%lu,%d,%d,%d,%.3f,%.3f,%.3f,%.4f,%.4f,%.4f\n", (unsigned long)solution.timeUs, solution.latitude, solution.longitude,
+                solution.altitude, solution.velocityNorth, solution.velocityEast, solution.velocityUp, solution.positionVariance[0],
+                solution.positionVariance[1], solution.positionVariance[2]);
+        fclose(file);
+    }
+
+    if (meanOffset > MAX_MEAN_OFFSET_M) {
+        fprintf(stderr, "Filtered track is %.2f m away from GPS fixes on average\n", meanOffset);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,184 @@
+#include "../include/motion_estimator.h"
+#include "../include/navigation_filter.h"
+#include "../include/position_history.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#define DEFAULT_BATCHES 200
+//Single query is too short for the clock, so every sample is the mean of a batch
+#define BATCH_SIZE 1000
+//Positions are stored at the rate of the navigation filter
+#define STORE_PERIOD_US 100000
+//Writer stops before coordinates of the test track overflow
+#define MAX_STORED 4000000
+
+volatile int32_t sink;
+
+//Straight climbing track, so interpolated position is known exactly at any time
+int32_t trackLatitude(uint64_t timeUs) {
+    return 600000000 + (int32_t)(timeUs / 1000);
+}
+
+int32_t trackLongitude(uint64_t timeUs) {
+    return 300000000 - (int32_t)(timeUs / 2000);
+}
+
+int32_t trackAltitude(uint64_t timeUs) {
+    return 10000 + (int32_t)(timeUs / 10000);
+}
+
+void storeTrack(PositionHistory &history, uint64_t index) {
+    uint64_t timeUs = index * STORE_PERIOD_US;
+    storePosition(history, timeUs, trackLatitude(timeUs), trackLongitude(timeUs), trackAltitude(timeUs));
+}
+
+//Error of the linear track is less than a unit from the integer division of stored positions
+bool onTrack(PositionSample &sample) {
+    return (abs(sample.latitude - trackLatitude(sample.timeUs)) <= 1) && (abs(sample.longitude - trackLongitude(sample.timeUs)) <= 1)
+        && (abs(sample.altitude - trackAltitude(sample.timeUs)) <= 1);
+}
+
+float trackHeading() {
+    float north = 1000.0f * METERS_PER_COORDINATE_UNIT;
+    float east = -500.0f * METERS_PER_COORDINATE_UNIT * cosf(trackLatitude(0) * (float)M_PI / 1800000000.0f);
+    return atan2f(east, north) * 180.0f / (float)M_PI + 360.0f;
+}
+
+//Velocity of the test track is 1000 units of latitude, -500 units of longitude and 100 cm of altitude per second
+bool onCourse(MotionEstimator &estimator) {
+    float cosLatitude = cosf(trackLatitude(estimator.timeUs) * (float)M_PI / 1800000000.0f);
+    return (fabsf(estimator.velocityNorth - 1000.0f * METERS_PER_COORDINATE_UNIT) < 0.01f)
+        && (fabsf(estimator.velocityEast + 500.0f * METERS_PER_COORDINATE_UNIT * cosLatitude) < 0.01f)
+        && (fabsf(estimator.velocityUp - 1.0f) < 0.01f) && (fabsf(estimator.heading - trackHeading()) < 0.1f);
+}
+
+void printHeader() {
+    fprintf(stdout, "operation,stored,calls,calls_per_sec,mean_ns,p50_ns,p90_ns,p99_ns,max_ns\n");
+}
+
+void measure(const char* operation, uint64_t stored, int batches, std::function<void()> call) {
+    std::vector<double> latencies;
+    for (int i = 0; i < batches; i++) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (int j = 0; j < BATCH_SIZE; j++)
+            call();
+        latencies.push_back(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / BATCH_SIZE);
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    size_t size = latencies.size();
+    double total = 0;
+    for (double latency : latencies)
+        total += latency;
+    fprintf(stdout, "%s,%llu,%zu,%.0f,%.1f,%.1f,%.1f,%.1f,%.1f\n", operation, (unsigned long long)stored, size * BATCH_SIZE,
+        1000000000.0 * size / total, total / size, latencies[size / 2], latencies[(size * 90) / 100], latencies[(size * 99) / 100],
+        latencies[size - 1]);
+}
+
+int main(int argc, char** argv) {
+    int batches = DEFAULT_BATCHES;
+    bool header = true;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--no-header"))
+            header = false;
+        else
+            batches = atoi(argv[i]);
+    }
+    if (batches <= 0) {
+        fprintf(stderr, "Usage: %s [batches] [--no-header]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    static PositionHistory history;
+    PositionSample sample;
+    if (getPositionAt(history, 0, sample)) {
+        fprintf(stderr, "Empty history gives a position\n");
+        return EXIT_FAILURE;
+    }
+
+    //History is filled twice over, so only the newest positions are kept
+    uint64_t stored = 2 * POSITION_HISTORY_SIZE;
+    for (uint64_t i = 0; i < stored; i++)
+        storeTrack(history, i);
+    uint64_t oldestUs = (stored - POSITION_HISTORY_SIZE + 1) * STORE_PERIOD_US;
+    uint64_t newestUs = (stored - 1) * STORE_PERIOD_US;
+    for (uint64_t timeUs = oldestUs; timeUs <= newestUs; timeUs += 12345) {
+        if (!getPositionAt(history, timeUs, sample) || (sample.timeUs != timeUs) || !onTrack(sample)) {
+            fprintf(stderr, "Wrong position at %llu us\n", (unsigned long long)timeUs);
+            return EXIT_FAILURE;
+        }
+    }
+    if (getPositionAt(history, oldestUs - STORE_PERIOD_US, sample)
+        || getPositionAt(history, newestUs + 1000ull * POSITION_HISTORY_MAX_GAP_MS + 1, sample)) {
+        fprintf(stderr, "Position is given outside of the history\n");
+        return EXIT_FAILURE;
+    }
+
+    if (header)
+        printHeader();
+    uint64_t timeUs = oldestUs;
+    measure("query", stored, batches, [&]() {
+        timeUs = (timeUs + 7919) % (newestUs - oldestUs) + oldestUs;
+        getPositionAt(history, timeUs, sample);
+        sink = sample.latitude;
+    });
+    measure("last", stored, batches, [&]() { getLastPosition(history, sample); sink = sample.latitude; });
+
+    //Track goes north-north-west at 60 degrees of latitude, where a unit of longitude is half as long as one of latitude
+    MotionEstimator estimator = {};
+    if (!updateMotionEstimator(estimator, history) || !onCourse(estimator)) {
+        fprintf(stderr, "Wrong velocity of the track: %.3f m/s north, %.3f m/s east, %.3f m/s up, heading %.2f\n",
+            estimator.velocityNorth, estimator.velocityEast, estimator.velocityUp, estimator.heading);
+        return EXIT_FAILURE;
+    }
+    getLastPosition(history, sample);
+    PositionSample previous;
+    getPositionAt(history, sample.timeUs - STORE_PERIOD_US, previous);
+    float legacyAzimuth = atan2f(sample.longitude - previous.longitude, sample.latitude - previous.latitude) * 180.0f / (float)M_PI;
+    fprintf(stderr, "Track heading %.2f, estimated %.2f, unscaled azimuth of the last step %.2f\n", trackHeading(), estimator.heading,
+        legacyAzimuth + 360.0f);
+    measure("motion", stored, batches, [&]() {
+        estimator.timeUs = 0;
+        updateMotionEstimator(estimator, history);
+        sink = (int32_t)estimator.heading;
+    });
+
+    //Readers go on while a writer stores positions as fast as it can, every given position has to stay on the track
+    std::atomic<bool> writing(true);
+    std::thread writer([&]() {
+        while (writing.load(std::memory_order_relaxed) && (stored < MAX_STORED))
+            storeTrack(history, stored++);
+    });
+    uint64_t queries = 0, misses = 0, errors = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(500)) {
+        //Reader can be preempted for longer than the writer needs to go around the history
+        if (!getLastPosition(history, sample)) {
+            misses++;
+            continue;
+        }
+        uint64_t queryUs = sample.timeUs - (queries % (POSITION_HISTORY_SIZE / 2)) * STORE_PERIOD_US - 54321;
+        if (!getPositionAt(history, queryUs, sample))
+            misses++;
+        else if (!onTrack(sample))
+            errors++;
+        queries++;
+    }
+    writing.store(false, std::memory_order_relaxed);
+    writer.join();
+    fprintf(stderr, "Concurrent writer: %llu positions stored, %llu queries, %llu overwritten while read, %llu wrong\n",
+        (unsigned long long)stored, (unsigned long long)queries, (unsigned long long)misses, (unsigned long long)errors);
+    if (errors)
+        return EXIT_FAILURE;
+
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,309 @@
+#include "../include/nmea_parser.h"
+#include "../include/nmea_reader.h"
+#include "../include/ubx_parser.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <vector>
+
+#define DEFAULT_BATCHES 50
+
+//Bytes returned by one UART read; real reads return what has arrived during the timeout
+const uint32_t chunkSizes[] = { 16, 64, 256, 1024 };
+
+struct Fix {
+    int32_t latitude;
+    int32_t longitude;
+};
+
+std::vector<uint8_t> gpsLog;
+size_t logPosition;
+uint32_t readCalls;
+
+//Stand-ins for UartReadByte and UartRead, every call is a round trip to the UART driver on the board
+__attribute__((noinline)) bool readLogByte(uint8_t* value) {
+    readCalls++;
+    if (logPosition >= gpsLog.size())
+        return false;
+    *value = gpsLog[logPosition++];
+    return true;
+}
+
+__attribute__((noinline)) uint32_t readLogChunk(uint8_t* buffer, uint32_t size, uint32_t chunkSize) {
+    readCalls++;
+    uint32_t readBytes = std::min((size_t)std::min(size, chunkSize), gpsLog.size() - logPosition);
+    memcpy(buffer, gpsLog.data() + logPosition, readBytes);
+    logPosition += readBytes;
+    return readBytes;
+}
+
+//Per-byte parser used by Navigation System before, kept for comparison
+void legacyReadLog(std::vector<Fix> &fixes) {
+    bool read, update;
+    uint8_t value;
+    int mode, idx;
+    int32_t latitude, longitude;
+    char head[8], satsStr[8], dopStr[8], latStr[16], lngStr[16];
+
+    while (logPosition < gpsLog.size()) {
+        update = true;
+        read = true;
+        mode = 0;
+        idx = 0;
+
+        while (read) {
+            if (!readLogByte(&value))
+                return;
+            switch (mode) {
+            case 0:
+                if (value == '$')
+                    mode = 1;
+                break;
+            case 1:
+                if (idx >= 8) {
+                    read = false;
+                    update = false;
+                }
+                else if (value == ',') {
+                    head[idx] = '\0';
+                    if ((head[2] == 'G') && (head[3] == 'G') && (head[4] == 'A'))
+                        mode = 2;
+                    else
+                        mode = 0;
+                    idx = 0;
+                }
+                else {
+                    head[idx] = value;
+                    idx++;
+                }
+                break;
+            case 2:
+            case 7:
+                if (value == ',')
+                    mode++;
+                break;
+            case 3:
+            case 5:
+            case 8:
+            case 9: {
+                char* field = (mode == 3) ? latStr : ((mode == 5) ? lngStr : ((mode == 8) ? satsStr : dopStr));
+                int fieldSize = ((mode == 3) || (mode == 5)) ? 16 : 8;
+                if (idx >= fieldSize) {
+                    read = false;
+                    update = false;
+                }
+                else if (value == ',') {
+                    field[idx] = '\0';
+                    idx = 0;
+                    if (mode == 9)
+                        read = false;
+                    else
+                        mode++;
+                }
+                else {
+                    field[idx] = value;
+                    idx++;
+                }
+                break;
+            }
+            case 4:
+            case 6:
+                if (value == ',')
+                    mode++;
+                else if ((value != 'N') && (value != 'S') && (value != 'E') && (value != 'W')) {
+                    read = false;
+                    update = false;
+                }
+                break;
+            }
+        }
+
+        //Empty position of a sentence without a fix was also turned into coordinates
+        if (update && latStr[0]) {
+            longitude = round(10000000 * atof(lngStr + 3) / 60.0f);
+            latitude = round(10000000 * atof(latStr + 2) / 60.0f);
+            lngStr[3] = '\0';
+            latStr[2] = '\0';
+            longitude += 10000000 * atoi(lngStr);
+            latitude += 10000000 * atoi(latStr);
+            fixes.push_back({ latitude, longitude });
+        }
+    }
+}
+
+void readLog(uint32_t chunkSize, std::vector<Fix> &fixes, uint32_t &sentences, uint32_t &errors) {
+    static NmeaReader reader;
+    initNmeaReader(reader);
+    GpsFix fix;
+    initGpsFix(fix);
+    char sentence[NMEA_MAX_SENTENCE_LENGTH + 1];
+    uint32_t length;
+    errors = 0;
+
+    while (logPosition < gpsLog.size()) {
+        uint32_t freeSize;
+        uint8_t* freeSpace = getNmeaWriteSpace(reader, freeSize);
+        commitNmeaWrite(reader, readLogChunk(freeSpace, freeSize, chunkSize));
+
+        while (nextNmeaSentence(reader, sentence, length)) {
+            if (!parseNmeaSentence(sentence, length, fix))
+                errors++;
+            else if (fix.updated & GPS_POSITION_UPDATED)
+                fixes.push_back({ fix.latitude, fix.longitude });
+            fix.updated = 0;
+        }
+    }
+    sentences = reader.sentences;
+}
+
+void readUbxLog(uint32_t chunkSize, std::vector<Fix> &fixes, uint32_t &frames, uint32_t &errors) {
+    static NmeaReader reader;
+    initNmeaReader(reader);
+    GpsFix fix;
+    initGpsFix(fix);
+    uint8_t frameCopy[UBX_MAX_FRAME_SIZE];
+    const uint8_t* frame;
+    uint32_t length;
+    errors = 0;
+
+    while (logPosition < gpsLog.size()) {
+        uint32_t freeSize;
+        uint8_t* freeSpace = getNmeaWriteSpace(reader, freeSize);
+        commitNmeaWrite(reader, readLogChunk(freeSpace, freeSize, chunkSize));
+
+        while ((frame = nextUbxFrame(reader, frameCopy, length)) != NULL) {
+            if (!parseUbxFrame(frame, length, fix))
+                errors++;
+            else if (fix.updated & GPS_POSITION_UPDATED)
+                fixes.push_back({ fix.latitude, fix.longitude });
+            fix.updated = 0;
+        }
+    }
+    frames = reader.sentences;
+}
+
+int loadLog(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) {
+        fprintf(stderr, "Failed to open GPS log %s\n", path);
+        return 0;
+    }
+    gpsLog.clear();
+    uint8_t buffer[4096];
+    size_t readBytes;
+    while ((readBytes = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        gpsLog.insert(gpsLog.end(), buffer, buffer + readBytes);
+    fclose(file);
+    return 1;
+}
+
+bool sameFixes(std::vector<Fix> &first, std::vector<Fix> &second) {
+    if (first.size() != second.size())
+        return false;
+    for (size_t i = 0; i < first.size(); i++)
+        if ((first[i].latitude != second[i].latitude) || (first[i].longitude != second[i].longitude))
+            return false;
+    return true;
+}
+
+void printHeader() {
+    fprintf(stdout, "implementation,chunk_bytes,log_bytes,messages,fixes,reads_per_message,mb_per_sec,mean_ns_per_message,p50_ns_per_message,p99_ns_per_message,mean_ns_per_fix\n");
+}
+
+void measure(const char* implementation, uint32_t chunkSize, uint32_t messages, size_t fixes, int batches, std::function<void()> call) {
+    std::vector<double> latencies;
+    uint32_t calls = 0;
+    for (int i = 0; i < batches; i++) {
+        logPosition = 0;
+        readCalls = 0;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        call();
+        latencies.push_back(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / messages);
+        calls = readCalls;
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    size_t size = latencies.size();
+    double total = 0;
+    for (double latency : latencies)
+        total += latency;
+    double mean = total / size;
+    fprintf(stdout, "%s,%u,%zu,%u,%zu,%.2f,%.1f,%.1f,%.1f,%.1f,%.1f\n", implementation, chunkSize, gpsLog.size(), messages, fixes,
+        (double)calls / messages, 1000.0 * gpsLog.size() / (mean * messages), mean, latencies[size / 2], latencies[(size * 99) / 100],
+        mean * messages / fixes);
+}
+
+int main(int argc, char** argv) {
+    int batches = DEFAULT_BATCHES;
+    bool header = true;
+    const char* logPath = NMEA_LOG_PATH;
+    const char* ubxLogPath = UBX_LOG_PATH;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--no-header"))
+            header = false;
+        else if (!strncmp(argv[i], "--log=", 6))
+            logPath = argv[i] + 6;
+        else if (!strncmp(argv[i], "--ubx-log=", 10))
+            ubxLogPath = argv[i] + 10;
+        else
+            batches = atoi(argv[i]);
+    }
+    if (batches <= 0) {
+        fprintf(stderr, "Usage: %s [batches] [--log=<recorded NMEA output>] [--ubx-log=<recorded UBX output>] [--no-header]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (!loadLog(logPath))
+        return EXIT_FAILURE;
+
+    //Both readers have to find the same fixes before they are compared
+    std::vector<Fix> legacyFixes, fixes;
+    uint32_t sentences = 0, errors = 0;
+    logPosition = 0;
+    legacyReadLog(legacyFixes);
+    for (uint32_t chunkSize : chunkSizes) {
+        fixes.clear();
+        logPosition = 0;
+        readLog(chunkSize, fixes, sentences, errors);
+        if (errors)
+            fprintf(stderr, "%u sentences of the log have wrong checksum or format\n", errors);
+        if (!sameFixes(fixes, legacyFixes)) {
+            fprintf(stderr, "Readers give different fixes for %u-byte reads\n", chunkSize);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (header)
+        printHeader();
+    measure("legacy", 1, sentences, legacyFixes.size(), batches, [&]() { fixes.clear(); legacyReadLog(fixes); });
+    for (uint32_t chunkSize : chunkSizes) {
+        uint32_t runSentences, runErrors;
+        measure("ring", chunkSize, sentences, legacyFixes.size(), batches,
+            [&]() { fixes.clear(); readLog(chunkSize, fixes, runSentences, runErrors); });
+    }
+
+    //UBX log is a different recording, so fixes are only checked to be found in every frame with a 3D fix
+    if (!loadLog(ubxLogPath))
+        return EXIT_FAILURE;
+    uint32_t frames = 0;
+    for (uint32_t chunkSize : chunkSizes) {
+        fixes.clear();
+        logPosition = 0;
+        readUbxLog(chunkSize, fixes, frames, errors);
+        if (errors)
+            fprintf(stderr, "%u frames of the UBX log have wrong format\n", errors);
+        fprintf(stderr, "UBX log, %u-byte reads: %u frames, %zu fixes\n", chunkSize, frames, fixes.size());
+    }
+    size_t ubxFixes = fixes.size();
+    for (uint32_t chunkSize : chunkSizes) {
+        uint32_t runFrames, runErrors;
+        measure("ubx", chunkSize, frames, ubxFixes, batches, [&]() { fixes.clear(); readUbxLog(chunkSize, fixes, runFrames, runErrors); });
+    }
+
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
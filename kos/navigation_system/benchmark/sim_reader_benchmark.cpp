@@ -0,0 +1,194 @@
+#include "../include/sim_sensor_reader.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <vector>
+
+#define DEFAULT_BATCHES 50
+#define STREAM_MESSAGES 20000
+//Damaged stream loses a byte of every LOST_BYTE_PERIOD-th message and gets noise before every NOISE_PERIOD-th one
+#define LOST_BYTE_PERIOD 97
+#define NOISE_PERIOD 89
+
+//Bytes returned by one socket read; the simulator sends a message at a time, reads return what has arrived since the last one
+const uint32_t chunkSizes[] = { 16, 256, 4096 };
+
+struct ReadResult {
+    uint32_t messages;
+    uint32_t wrong;
+    uint32_t resyncs;
+};
+
+std::vector<uint8_t> stream;
+size_t streamPosition;
+uint32_t readCalls;
+
+//Message number is put into every field, so a message decoded from misaligned bytes is recognized
+void putMessage(std::vector<uint8_t> &bytes, uint32_t number, bool loseByte) {
+    SimSensorDataMessage message;
+    memcpy(message.head, SimSensorDataMessageHead, SIM_SENSOR_DATA_MESSAGE_HEAD_SIZE);
+    message.latitude = 557000000 + number;
+    message.longitude = 376000000 + 2 * number;
+    message.altitude = 15000 + 3 * number;
+    uint8_t* data = (uint8_t*)&message;
+    for (uint32_t i = 0; i < sizeof(message); i++)
+        if (!loseByte || (i != (number * 7) % sizeof(message)))
+            bytes.push_back(data[i]);
+}
+
+bool isGenuine(SimSensorDataMessage &message) {
+    uint32_t number = message.latitude - 557000000;
+    return (number < STREAM_MESSAGES) && (message.longitude == (int32_t)(376000000 + 2 * number))
+        && (message.altitude == (int32_t)(15000 + 3 * number));
+}
+
+void makeStream(bool damaged) {
+    //Noise starts with the first header byte, which is the case the per-byte reader could not handle
+    const uint8_t noise[] = { 0x71, 0x71, 0x11 };
+    stream.clear();
+    for (uint32_t i = 0; i < STREAM_MESSAGES; i++) {
+        if (damaged && (i % NOISE_PERIOD == NOISE_PERIOD - 1))
+            stream.insert(stream.end(), noise, noise + sizeof(noise));
+        putMessage(stream, i, damaged && (i % LOST_BYTE_PERIOD == LOST_BYTE_PERIOD - 1));
+    }
+}
+
+//Stand-in for read on the simulator socket, every call is a system call on the board
+__attribute__((noinline)) ssize_t readStream(uint8_t* buffer, size_t size, uint32_t chunkSize) {
+    readCalls++;
+    size_t readBytes = std::min(std::min(size, (size_t)chunkSize), stream.size() - streamPosition);
+    memcpy(buffer, stream.data() + streamPosition, readBytes);
+    streamPosition += readBytes;
+    return readBytes;
+}
+
+//Reader used by Navigation System before, kept for comparison
+void legacyReadStream(ReadResult &result) {
+    bool restart, synchronized = true;
+    uint8_t message[sizeof(SimSensorDataMessage)];
+    result = { 0, 0, 0 };
+
+    while (streamPosition < stream.size()) {
+        restart = false;
+        for (int i = 0; i < SIM_SENSOR_DATA_MESSAGE_HEAD_SIZE; i++) {
+            if (readStream(message + i, 1, 1) != 1)
+                return;
+            if (message[i] != SimSensorDataMessageHead[i]) {
+                //Resync is counted once for a run of mismatches, like in the buffered reader
+                if (synchronized)
+                    result.resyncs++;
+                synchronized = false;
+                restart = true;
+                break;
+            }
+        }
+
+        if (!restart) {
+            ssize_t expectedSize = sizeof(SimSensorDataMessage) - SIM_SENSOR_DATA_MESSAGE_HEAD_SIZE;
+            if (readStream(message + SIM_SENSOR_DATA_MESSAGE_HEAD_SIZE, expectedSize, expectedSize) == expectedSize) {
+                synchronized = true;
+                SimSensorDataMessage *data = (SimSensorDataMessage*)message;
+                if (isGenuine(*data))
+                    result.messages++;
+                else
+                    result.wrong++;
+            }
+        }
+    }
+}
+
+void readBuffered(uint32_t chunkSize, ReadResult &result) {
+    static SimSensorReader reader;
+    initSimSensorReader(reader);
+    SimSensorDataMessage message;
+    result = { 0, 0, 0 };
+
+    while (streamPosition < stream.size()) {
+        uint32_t freeSize;
+        uint8_t* freeSpace = getSimSensorWriteSpace(reader, freeSize);
+        commitSimSensorWrite(reader, readStream(freeSpace, freeSize, chunkSize));
+        while (nextSimSensorMessage(reader, message)) {
+            if (isGenuine(message))
+                result.messages++;
+            else
+                result.wrong++;
+        }
+    }
+    result.resyncs = reader.resyncs;
+}
+
+void printHeader() {
+    fprintf(stdout, "implementation,stream,chunk_bytes,stream_bytes,messages_sent,messages_read,wrong_messages,resyncs,reads_per_message,mean_ns_per_message,p50_ns_per_message,p99_ns_per_message\n");
+}
+
+void measure(const char* implementation, const char* streamName, uint32_t chunkSize, int batches, std::function<void(ReadResult&)> call) {
+    std::vector<double> latencies;
+    ReadResult result;
+    uint32_t calls = 0;
+    for (int i = 0; i < batches; i++) {
+        streamPosition = 0;
+        readCalls = 0;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        call(result);
+        latencies.push_back(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / STREAM_MESSAGES);
+        calls = readCalls;
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    size_t size = latencies.size();
+    double total = 0;
+    for (double latency : latencies)
+        total += latency;
+    fprintf(stdout, "%s,%s,%u,%zu,%u,%u,%u,%u,%.2f,%.1f,%.1f,%.1f\n", implementation, streamName, chunkSize, stream.size(), STREAM_MESSAGES,
+        result.messages, result.wrong, result.resyncs, (double)calls / STREAM_MESSAGES, total / size, latencies[size / 2],
+        latencies[(size * 99) / 100]);
+}
+
+int main(int argc, char** argv) {
+    int batches = DEFAULT_BATCHES;
+    bool header = true;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--no-header"))
+            header = false;
+        else
+            batches = atoi(argv[i]);
+    }
+    if (batches <= 0) {
+        fprintf(stderr, "Usage: %s [batches] [--no-header]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    //Clean stream has to be read completely, damaged one may only lose the messages that were damaged
+    ReadResult result;
+    uint32_t damagedMessages = STREAM_MESSAGES / LOST_BYTE_PERIOD + STREAM_MESSAGES / NOISE_PERIOD;
+    for (int damaged = 0; damaged < 2; damaged++) {
+        makeStream(damaged);
+        for (uint32_t chunkSize : chunkSizes) {
+            streamPosition = 0;
+            readBuffered(chunkSize, result);
+            uint32_t expected = damaged ? (STREAM_MESSAGES - damagedMessages) : STREAM_MESSAGES;
+            //Message that lost a byte can only be rejected when the next one has already been read with it
+            if ((result.wrong > (damaged ? STREAM_MESSAGES / LOST_BYTE_PERIOD : 0)) || (result.messages < expected)) {
+                fprintf(stderr, "Buffered reader with %u-byte reads finds %u messages and %u wrong ones in the %s stream\n", chunkSize,
+                    result.messages, result.wrong, damaged ? "damaged" : "clean");
+                return EXIT_FAILURE;
+            }
+        }
+    }
+
+    if (header)
+        printHeader();
+    for (int damaged = 0; damaged < 2; damaged++) {
+        const char* streamName = damaged ? "damaged" : "clean";
+        makeStream(damaged);
+        measure("legacy", streamName, 1, batches, [&](ReadResult &result) { legacyReadStream(result); });
+        for (uint32_t chunkSize : chunkSizes)
+            measure("buffered", streamName, chunkSize, batches, [&](ReadResult &result) { readBuffered(chunkSize, result); });
+    }
+
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stdint.h>
+
+//Oversampling codes of ctrl_meas (0xF4): 1 to 5 mean x1, x2, x4, x8 and x16;
+//IIR filter code of config (0xF5): 0 is off, 1 to 4 mean coefficients 2, 4, 8 and 16
+#ifndef BAROMETER_PRESSURE_OVERSAMPLING
+#define BAROMETER_PRESSURE_OVERSAMPLING 5
+#endif
+#ifndef BAROMETER_TEMPERATURE_OVERSAMPLING
+#define BAROMETER_TEMPERATURE_OVERSAMPLING 2
+#endif
+#ifndef BAROMETER_FILTER
+#define BAROMETER_FILTER 4
+#endif
+//Rate at which samples are read; standby time of the normal mode is chosen so that the sensor
+//finishes a new conversion between reads
+#ifndef BAROMETER_RATE_HZ
+#define BAROMETER_RATE_HZ 2
+#endif
+
+//Pressure and temperature registers 0xF7..0xFC are read in one burst, so both come from the same conversion
+#define BMP280_DATA_REGISTER 0xF7
+#define BMP280_DATA_SIZE 6
+
+//Sea level pressure and pressure range of the altitude table, Pa; the range covers about -700 m to 5500 m
+#define BMP280_SEA_LEVEL_PRESSURE 101325
+#define ALTITUDE_TABLE_MIN_PRESSURE 50000
+#define ALTITUDE_TABLE_MAX_PRESSURE 110000
+//Pressure step of the table is 2^ALTITUDE_TABLE_STEP_BITS Pa, interpolation error stays below 2 cm
+#define ALTITUDE_TABLE_STEP_BITS 8
+
+//Trimming parameters dig_T1..dig_T3 and dig_P1..dig_P9 read from 0x88..0x9F
+struct Bmp280Calibration {
+    int32_t temperature[3];
+    int32_t pressure[9];
+};
+
+uint32_t getBmp280MeasurementTimeUs();
+uint8_t getBmp280ControlRegister();
+uint8_t getBmp280ConfigRegister(uint32_t samplePeriodUs);
+void parseBmp280Data(const uint8_t* data, int32_t &rawPressure, int32_t &rawTemperature);
+
+//Integer compensation from the BMP280 datasheet: temperature in 0.01 degrees Celsius,
+//pressure in Pa as unsigned Q24.8 fixed point, 0 if calibration is broken
+int32_t compensateBmp280Temperature(const Bmp280Calibration &calibration, int32_t rawTemperature, int32_t &fineTemperature);
+uint32_t compensateBmp280Pressure(const Bmp280Calibration &calibration, int32_t rawPressure, int32_t fineTemperature);
+
+void initAltitudeTable();
+//Altitude in cm by Q24.8 pressure, pressure out of the table range is clamped to it
+int32_t pressureToAltitude(uint32_t pressure);
\ No newline at end of file
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "position_history.h"
+
+#include <stdint.h>
+
+//Velocity is the difference of positions this far apart in the history, ms
+#ifndef MOTION_WINDOW_MS
+#define MOTION_WINDOW_MS 1000
+#endif
+//Time constant of the exponential smoothing of the differences, ms
+#ifndef MOTION_SMOOTHING_MS
+#define MOTION_SMOOTHING_MS 1000
+#endif
+//Heading is not updated below this ground speed, the direction of GPS noise is not the direction of flight, m/s
+#ifndef MOTION_MIN_HEADING_SPEED
+#define MOTION_MIN_HEADING_SPEED 1.0f
+#endif
+
+//Velocity is in m/s of the local north-east-up frame, heading in degrees clockwise from the north in [0, 360).
+//Zero-initialized estimator has no estimate
+struct MotionEstimator {
+    bool hasVelocity;
+    bool hasHeading;
+    uint64_t timeUs;
+    float velocityNorth;
+    float velocityEast;
+    float velocityUp;
+    float groundSpeed;
+    float heading;
+};
+
+int updateMotionEstimator(MotionEstimator &estimator, const PositionHistory &history);
+//Azimuth is in 1e-7 degrees from -180 to 180, heading from 0 to 360 would not fit into int32
+int32_t headingToAzimuth(float heading);
\ No newline at end of file
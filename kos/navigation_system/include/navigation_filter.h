@@ -0,0 +1,69 @@
+#pragma once
+
+#include <stdint.h>
+
+//Rate at which the filter predicts the solution between measurements and publishes it
+#ifndef NAVIGATION_FILTER_RATE_HZ
+#define NAVIGATION_FILTER_RATE_HZ 10
+#endif
+//Standard deviation of the acceleration the filter expects from the drone, m/s^2
+#ifndef NAVIGATION_FILTER_ACCELERATION_NOISE
+#define NAVIGATION_FILTER_ACCELERATION_NOISE 2.0f
+#endif
+//Standard deviations of measurements: GPS position per unit of HDOP when the receiver does not report
+//its accuracy, GPS velocity and barometric altitude; m and m/s
+#ifndef NAVIGATION_FILTER_GPS_NOISE
+#define NAVIGATION_FILTER_GPS_NOISE 2.5f
+#endif
+#ifndef NAVIGATION_FILTER_VELOCITY_NOISE
+#define NAVIGATION_FILTER_VELOCITY_NOISE 0.3f
+#endif
+#ifndef NAVIGATION_FILTER_BAROMETER_NOISE
+#define NAVIGATION_FILTER_BAROMETER_NOISE 0.5f
+#endif
+
+//Meters in 1e-7 degree of latitude on the mean Earth radius
+#define METERS_PER_COORDINATE_UNIT 0.0111194927f
+
+//Position and velocity along one axis of the local north-east-up frame with their covariance
+struct AxisFilter {
+    float position;
+    float velocity;
+    float positionVariance;
+    float covariance;
+    float velocityVariance;
+    uint32_t rejected;
+};
+
+//Filter works in meters around the origin, which is moved to the drone when it flies far away
+struct NavigationFilter {
+    bool hasHorizontal;
+    bool hasVertical;
+    uint64_t timeUs;
+    int32_t originLatitude;
+    int32_t originLongitude;
+    float metersPerLongitudeUnit;
+    AxisFilter north;
+    AxisFilter east;
+    AxisFilter up;
+};
+
+//Coordinates are in 1e-7 degrees, altitude in cm, velocity in m/s, variances in m^2 and (m/s)^2
+struct NavigationSolution {
+    uint64_t timeUs;
+    int32_t latitude;
+    int32_t longitude;
+    int32_t altitude;
+    float velocityNorth;
+    float velocityEast;
+    float velocityUp;
+    float positionVariance[3];
+    float velocityVariance[3];
+};
+
+void initNavigationFilter(NavigationFilter &filter);
+void predictNavigationFilter(NavigationFilter &filter, uint64_t timeUs);
+int updateNavigationPosition(NavigationFilter &filter, uint64_t timeUs, int32_t latitude, int32_t longitude, float deviation);
+int updateNavigationVelocity(NavigationFilter &filter, uint64_t timeUs, float groundSpeed, float course, float deviation);
+int updateNavigationAltitude(NavigationFilter &filter, uint64_t timeUs, int32_t altitude, float deviation);
+int getFilterSolution(NavigationFilter &filter, NavigationSolution &solution);
\ No newline at end of file
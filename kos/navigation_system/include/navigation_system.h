@@ -1,7 +1,29 @@
 #pragma once
 
+#include "motion_estimator.h"
+#include "navigation_filter.h"
+#include "position_history.h"
+
 #include <stdint.h>
 
+//Telemetry is sent when the drone has moved, climbed or turned more than these since the last sent sample,
+//but not more often than the minimal interval and not less often than the maximal one
+#ifndef TELEMETRY_MIN_INTERVAL_MS
+#define TELEMETRY_MIN_INTERVAL_MS 250
+#endif
+#ifndef TELEMETRY_MAX_INTERVAL_MS
+#define TELEMETRY_MAX_INTERVAL_MS 5000
+#endif
+#ifndef TELEMETRY_DISTANCE_M
+#define TELEMETRY_DISTANCE_M 5.0f
+#endif
+#ifndef TELEMETRY_ALTITUDE_CM
+#define TELEMETRY_ALTITUDE_CM 200
+#endif
+#ifndef TELEMETRY_HEADING_DEG
+#define TELEMETRY_HEADING_DEG 15.0f
+#endif
+
 int initNavigationSystem();
 int initSensors();
 
@@ -12,7 +34,18 @@ void sendCoords();
 
 void setGpsInfo(float dop, int32_t sats);
 int getGpsInfo(float& dop, int32_t &sats);
+void setGpsVelocity(float groundSpeed, float course);
+int getGpsVelocity(float &groundSpeed, float &course);
+void setGpsAccuracy(float horizontalAccuracy);
+int getGpsAccuracy(float &horizontalAccuracy);
 
 void setAltitude(int32_t altitude);
 void setCoords(int32_t latitude, int32_t longitude);
-int getCoords(int32_t &latitude, int32_t &longitude, int32_t &altitude);
\ No newline at end of file
+int getCoords(int32_t &latitude, int32_t &longitude, int32_t &altitude);
+int getCoordsAt(uint64_t time, int32_t &latitude, int32_t &longitude, int32_t &altitude);
+int getMotion(float &groundSpeed, float &heading, float &climbRate);
+
+#ifdef NAVIGATION_FILTER
+void runNavigationFilter();
+int getNavigationSolution(NavigationSolution &solution);
+#endif
\ No newline at end of file
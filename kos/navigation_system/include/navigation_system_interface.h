@@ -6,13 +6,20 @@
 nk_err_t GetCoordsImpl(struct NavigationSystemInterface *self,
                     const NavigationSystemInterface_GetCoords_req *req, const struct nk_arena *reqArena,
                     NavigationSystemInterface_GetCoords_res *res, struct nk_arena *resArena);
+nk_err_t GetCoordsAtImpl(struct NavigationSystemInterface *self,
+                    const NavigationSystemInterface_GetCoordsAt_req *req, const struct nk_arena *reqArena,
+                    NavigationSystemInterface_GetCoordsAt_res *res, struct nk_arena *resArena);
 nk_err_t GetGpsInfoImpl(struct NavigationSystemInterface *self,
                     const NavigationSystemInterface_GetGpsInfo_req *req, const struct nk_arena *reqArena,
                     NavigationSystemInterface_GetGpsInfo_res *res, struct nk_arena *resArena);
+nk_err_t GetVelocityImpl(struct NavigationSystemInterface *self,
+                    const NavigationSystemInterface_GetVelocity_req *req, const struct nk_arena *reqArena,
+                    NavigationSystemInterface_GetVelocity_res *res, struct nk_arena *resArena);
 
 static struct NavigationSystemInterface *CreateNavigationSystemInterfaceImpl(void) {
     static const struct NavigationSystemInterface_ops Ops = {
-        .GetCoords = GetCoordsImpl, .GetGpsInfo = GetGpsInfoImpl
+        .GetCoords = GetCoordsImpl, .GetCoordsAt = GetCoordsAtImpl, .GetGpsInfo = GetGpsInfoImpl,
+        .GetVelocity = GetVelocityImpl
     };
 
     static NavigationSystemInterface obj = {
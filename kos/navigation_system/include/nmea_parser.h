@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdint.h>
+
+//Bits of GpsFix::updated, they tell which part of the record the last sentences changed
+#define GPS_POSITION_UPDATED 0x01
+#define GPS_VELOCITY_UPDATED 0x02
+#define GPS_ACCURACY_UPDATED 0x04
+#define GPS_DOP_UPDATED 0x08
+
+//Fix collected from sentences of one receiver epoch, every sentence refreshes only its own fields.
+//Time is in ms since UTC midnight, time of week in ms of GPS week (only UBX gives it), coordinates in 1e-7 degrees,
+//altitude above sea level in cm, speed in m/s, course in degrees from true north, accuracy is a standard deviation in m
+struct GpsFix {
+    uint8_t updated;
+    bool valid;
+    uint32_t time;
+    uint32_t timeOfWeek;
+    int32_t latitude;
+    int32_t longitude;
+    int32_t altitude;
+    int32_t sats;
+    uint8_t fixType;
+    float hdop;
+    float pdop;
+    float vdop;
+    float groundSpeed;
+    float course;
+    float horizontalAccuracy;
+    float verticalAccuracy;
+};
+
+void initGpsFix(GpsFix &fix);
+int checkNmeaChecksum(const char* sentence, uint32_t length);
+int parseNmeaSentence(char* sentence, uint32_t length, GpsFix &fix);
\ No newline at end of file
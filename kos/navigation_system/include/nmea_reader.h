@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdint.h>
+
+//Ring buffer size, must be a power of two; it holds about a third of a second of GPS output at 115200 baud
+#ifndef NMEA_BUFFER_SIZE
+#define NMEA_BUFFER_SIZE 4096
+#endif
+//NMEA 0183 limits a sentence to 82 characters, proprietary ones are a bit longer;
+//buffer for a sentence has to hold one more character for the terminating zero
+#define NMEA_MAX_SENTENCE_LENGTH 128
+//UBX frame is a sync word, class, id and length, then payload and two checksum bytes
+#define UBX_HEADER_SIZE 6
+#define UBX_MAX_PAYLOAD_SIZE 512
+#define UBX_MAX_FRAME_SIZE (UBX_HEADER_SIZE + UBX_MAX_PAYLOAD_SIZE + 2)
+
+struct NmeaReader {
+    uint8_t buffer[NMEA_BUFFER_SIZE];
+    uint32_t head;
+    uint32_t tail;
+    uint32_t sentences;
+    uint32_t droppedBytes;
+};
+
+void initNmeaReader(NmeaReader &reader);
+uint8_t* getNmeaWriteSpace(NmeaReader &reader, uint32_t &size);
+void commitNmeaWrite(NmeaReader &reader, uint32_t size);
+int nextNmeaSentence(NmeaReader &reader, char* sentence, uint32_t &length);
+//Frame is returned in place when it does not wrap around the buffer end, otherwise it is copied to frameCopy;
+//returned pointer is valid until the next write to the reader
+const uint8_t* nextUbxFrame(NmeaReader &reader, uint8_t* frameCopy, uint32_t &length);
\ No newline at end of file
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+//Number of stored positions, has to be a power of two. History covers 100 s of filter solutions
+//at 10 Hz or 40 s of 25 Hz GPS fixes
+#ifndef POSITION_HISTORY_SIZE
+#define POSITION_HISTORY_SIZE 1024
+#endif
+//Positions further apart are not interpolated, the drone could have done anything between them
+#ifndef POSITION_HISTORY_MAX_GAP_MS
+#define POSITION_HISTORY_MAX_GAP_MS 2000
+#endif
+
+//Coordinates are in 1e-7 degrees, altitude in cm, time in microseconds of the steady clock
+struct PositionSample {
+    uint64_t timeUs;
+    int32_t latitude;
+    int32_t longitude;
+    int32_t altitude;
+};
+
+//Record is a seqlock: sequence is odd while the record is written, index tells which position it holds now
+struct PositionRecord {
+    std::atomic<uint32_t> sequence;
+    std::atomic<uint64_t> index;
+    std::atomic<uint64_t> timeUs;
+    std::atomic<int32_t> latitude;
+    std::atomic<int32_t> longitude;
+    std::atomic<int32_t> altitude;
+};
+
+//Only one thread can store positions at a time, any number of threads can read without locks.
+//Zero-initialized history is empty
+struct PositionHistory {
+    std::atomic<uint64_t> count;
+    PositionRecord records[POSITION_HISTORY_SIZE];
+};
+
+uint64_t getPositionTimeUs();
+
+void storePosition(PositionHistory &history, uint64_t timeUs, int32_t latitude, int32_t longitude, int32_t altitude);
+int getLastPosition(const PositionHistory &history, PositionSample &sample);
+int getPositionAt(const PositionHistory &history, uint64_t timeUs, PositionSample &sample);
\ No newline at end of file
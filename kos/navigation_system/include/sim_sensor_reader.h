@@ -0,0 +1,26 @@
+#pragma once
+
+#include "sim_sensor_data_message.h"
+
+#include <stdint.h>
+
+//Buffer holds a few hundred messages, so one read takes everything the simulator has sent since the previous one
+#ifndef SIM_SENSOR_BUFFER_SIZE
+#define SIM_SENSOR_BUFFER_SIZE 4096
+#endif
+
+//Unparsed bytes lie from start to size, they are moved to the buffer start before the next read
+struct SimSensorReader {
+    uint8_t buffer[SIM_SENSOR_BUFFER_SIZE];
+    uint32_t start;
+    uint32_t size;
+    bool synchronized;
+    uint32_t messages;
+    uint32_t resyncs;
+    uint32_t droppedBytes;
+};
+
+void initSimSensorReader(SimSensorReader &reader);
+uint8_t* getSimSensorWriteSpace(SimSensorReader &reader, uint32_t &size);
+void commitSimSensorWrite(SimSensorReader &reader, uint32_t size);
+int nextSimSensorMessage(SimSensorReader &reader, SimSensorDataMessage &message);
\ No newline at end of file
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "nmea_parser.h"
+
+#include <stdint.h>
+
+//Navigation rate in UBX mode, receivers of u-blox M9 generation give NAV-PVT at up to 25 Hz
+#ifndef GPS_UBX_RATE_HZ
+#define GPS_UBX_RATE_HZ 10
+#endif
+
+#define UBX_CLASS_NAV 0x01
+#define UBX_CLASS_CFG 0x06
+#define UBX_NAV_PVT 0x07
+#define UBX_CFG_VALSET 0x8A
+#define UBX_NAV_PVT_PAYLOAD_SIZE 92
+
+//Fletcher checksum over class, id, length and payload
+void computeUbxChecksum(const uint8_t* data, uint32_t size, uint8_t &checksumA, uint8_t &checksumB);
+uint32_t makeUbxFrame(uint8_t messageClass, uint8_t id, const uint8_t* payload, uint16_t payloadSize, uint8_t* frame);
+//CFG-VALSET that turns UART1 output to UBX only and sends NAV-PVT every navigation epoch
+uint32_t makeUbxNavPvtConfig(uint16_t measurementPeriodMs, uint8_t* frame);
+int parseUbxFrame(const uint8_t* frame, uint32_t length, GpsFix &fix);
\ No newline at end of file
@@ -0,0 +1,95 @@
+#include "../include/bmp280.h"
+
+#include <math.h>
+
+#define ALTITUDE_TABLE_SIZE (((ALTITUDE_TABLE_MAX_PRESSURE - ALTITUDE_TABLE_MIN_PRESSURE) >> ALTITUDE_TABLE_STEP_BITS) + 2)
+//Table step in Q24.8 pressure
+#define ALTITUDE_TABLE_STEP_SHIFT (ALTITUDE_TABLE_STEP_BITS + 8)
+
+#define BMP280_NORMAL_MODE 0x03
+#define BMP280_STANDBY_NUMBER 8
+
+static_assert((BAROMETER_PRESSURE_OVERSAMPLING >= 1) && (BAROMETER_PRESSURE_OVERSAMPLING <= 5), "Pressure oversampling code must be 1 to 5");
+static_assert((BAROMETER_TEMPERATURE_OVERSAMPLING >= 1) && (BAROMETER_TEMPERATURE_OVERSAMPLING <= 5), "Temperature oversampling code must be 1 to 5");
+static_assert((BAROMETER_FILTER >= 0) && (BAROMETER_FILTER <= 4), "Barometer filter code must be 0 to 4");
+
+//Standby times of the normal mode by t_sb code, us
+static const uint32_t bmp280StandbyUs[BMP280_STANDBY_NUMBER] = { 500, 62500, 125000, 250000, 500000, 1000000, 2000000, 4000000 };
+
+int32_t altitudeTable[ALTITUDE_TABLE_SIZE];
+
+//Maximum measurement time from the datasheet, every oversampled conversion takes up to 2.3 ms
+uint32_t getBmp280MeasurementTimeUs() {
+    uint32_t temperatureSamples = 1 << (BAROMETER_TEMPERATURE_OVERSAMPLING - 1);
+    uint32_t pressureSamples = 1 << (BAROMETER_PRESSURE_OVERSAMPLING - 1);
+    return 1250 + 2300 * temperatureSamples + 2300 * pressureSamples + 575;
+}
+
+uint8_t getBmp280ControlRegister() {
+    return (BAROMETER_TEMPERATURE_OVERSAMPLING << 5) | (BAROMETER_PRESSURE_OVERSAMPLING << 2) | BMP280_NORMAL_MODE;
+}
+
+//Longest standby that still gives a new conversion every sample period
+uint8_t getBmp280ConfigRegister(uint32_t samplePeriodUs) {
+    uint32_t measurementTimeUs = getBmp280MeasurementTimeUs();
+    uint8_t standby = 0;
+    for (uint8_t i = 1; i < BMP280_STANDBY_NUMBER; i++)
+        if (measurementTimeUs + bmp280StandbyUs[i] <= samplePeriodUs)
+            standby = i;
+    return (standby << 5) | (BAROMETER_FILTER << 2);
+}
+
+void parseBmp280Data(const uint8_t* data, int32_t &rawPressure, int32_t &rawTemperature) {
+    rawPressure = ((int32_t)data[0] << 12) | ((int32_t)data[1] << 4) | (data[2] >> 4);
+    rawTemperature = ((int32_t)data[3] << 12) | ((int32_t)data[4] << 4) | (data[5] >> 4);
+}
+
+int32_t compensateBmp280Temperature(const Bmp280Calibration &calibration, int32_t rawTemperature, int32_t &fineTemperature) {
+    const int32_t* t = calibration.temperature;
+    int32_t first = (((rawTemperature >> 3) - (t[0] * 2)) * t[1]) >> 11;
+    int32_t second = (((((rawTemperature >> 4) - t[0]) * ((rawTemperature >> 4) - t[0])) >> 12) * t[2]) >> 14;
+    fineTemperature = first + second;
+    return (fineTemperature * 5 + 128) >> 8;
+}
+
+uint32_t compensateBmp280Pressure(const Bmp280Calibration &calibration, int32_t rawPressure, int32_t fineTemperature) {
+    const int32_t* p = calibration.pressure;
+    //Left shifts of the datasheet are written as multiplications, they are applied to negative values
+    int64_t first = (int64_t)fineTemperature - 128000;
+    int64_t second = first * first * p[5];
+    second += first * p[4] * (1ll << 17);
+    second += (int64_t)p[3] * (1ll << 35);
+    first = ((first * first * p[2]) >> 8) + (first * p[1] * (1ll << 12));
+    first = (((1ll << 47) + first) * p[0]) >> 33;
+    if (first == 0)
+        return 0;
+
+    int64_t pressure = 1048576 - rawPressure;
+    pressure = ((pressure * (1ll << 31) - second) * 3125) / first;
+    first = (p[8] * (pressure >> 13) * (pressure >> 13)) >> 25;
+    second = (p[7] * pressure) >> 19;
+    return ((pressure + first + second) >> 8) + ((int64_t)p[6] * 16);
+}
+
+//Barometric formula is evaluated once per table node, samples only interpolate
+void initAltitudeTable() {
+    for (int i = 0; i < ALTITUDE_TABLE_SIZE; i++) {
+        double pressure = ALTITUDE_TABLE_MIN_PRESSURE + (i << ALTITUDE_TABLE_STEP_BITS);
+        altitudeTable[i] = round(4433000.0 * (1.0 - pow(pressure / BMP280_SEA_LEVEL_PRESSURE, 0.1903)));
+    }
+}
+
+int32_t pressureToAltitude(uint32_t pressure) {
+    uint32_t minPressure = ALTITUDE_TABLE_MIN_PRESSURE << 8;
+    uint32_t maxPressure = (ALTITUDE_TABLE_MIN_PRESSURE + ((ALTITUDE_TABLE_SIZE - 1) << ALTITUDE_TABLE_STEP_BITS)) << 8;
+    if (pressure <= minPressure)
+        return altitudeTable[0];
+    if (pressure >= maxPressure)
+        return altitudeTable[ALTITUDE_TABLE_SIZE - 1];
+
+    uint32_t offset = pressure - minPressure;
+    uint32_t index = offset >> ALTITUDE_TABLE_STEP_SHIFT;
+    int64_t fraction = offset & ((1 << ALTITUDE_TABLE_STEP_SHIFT) - 1);
+    int32_t difference = altitudeTable[index + 1] - altitudeTable[index];
+    return altitudeTable[index] + (int32_t)((difference * fraction) >> ALTITUDE_TABLE_STEP_SHIFT);
+}
\ No newline at end of file
@@ -12,6 +12,9 @@
 
 std::thread sensorThread;
 std::thread senderThread;
+#ifdef NAVIGATION_FILTER
+std::thread filterThread;
+#endif
 
 int main(void) {
     if (!initNavigationSystem())
@@ -22,6 +25,9 @@ int main(void) {
         sleep(1);
     }
 
+#ifdef NAVIGATION_FILTER
+    filterThread = std::thread(runNavigationFilter);
+#endif
     sensorThread = std::thread(getSensors);
 
     while (!hasPosition()) {
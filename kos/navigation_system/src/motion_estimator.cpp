@@ -0,0 +1,51 @@
+#include "../include/motion_estimator.h"
+#include "../include/navigation_filter.h"
+
+#include <math.h>
+
+//Takes the last position of the history, fails until the history is longer than the window
+int updateMotionEstimator(MotionEstimator &estimator, const PositionHistory &history) {
+    uint64_t windowUs = MOTION_WINDOW_MS * 1000ull;
+    PositionSample last, first;
+    if (!getLastPosition(history, last) || (last.timeUs <= estimator.timeUs) || (last.timeUs < windowUs)
+        || !getPositionAt(history, last.timeUs - windowUs, first))
+        return 0;
+
+    //Degrees are turned into meters of the local frame, a unit of longitude shrinks with cos(latitude)
+    float window = windowUs / 1000000.0f;
+    float metersPerLongitudeUnit = METERS_PER_COORDINATE_UNIT * cosf(last.latitude * (float)M_PI / 1800000000.0f);
+    float velocityNorth = (last.latitude - first.latitude) * METERS_PER_COORDINATE_UNIT / window;
+    float velocityEast = (last.longitude - first.longitude) * metersPerLongitudeUnit / window;
+    float velocityUp = (last.altitude - first.altitude) / (100.0f * window);
+
+    if (!estimator.hasVelocity) {
+        estimator.velocityNorth = velocityNorth;
+        estimator.velocityEast = velocityEast;
+        estimator.velocityUp = velocityUp;
+        estimator.hasVelocity = true;
+    }
+    else {
+        float dt = (last.timeUs - estimator.timeUs) / 1000.0f;
+        float gain = dt / (MOTION_SMOOTHING_MS + dt);
+        estimator.velocityNorth += gain * (velocityNorth - estimator.velocityNorth);
+        estimator.velocityEast += gain * (velocityEast - estimator.velocityEast);
+        estimator.velocityUp += gain * (velocityUp - estimator.velocityUp);
+    }
+    estimator.timeUs = last.timeUs;
+
+    //Last heading is kept while the drone hovers
+    estimator.groundSpeed = sqrtf(estimator.velocityNorth * estimator.velocityNorth + estimator.velocityEast * estimator.velocityEast);
+    if (estimator.groundSpeed >= MOTION_MIN_HEADING_SPEED) {
+        estimator.heading = atan2f(estimator.velocityEast, estimator.velocityNorth) * 180.0f / (float)M_PI;
+        if (estimator.heading < 0.0f)
+            estimator.heading += 360.0f;
+        estimator.hasHeading = true;
+    }
+    return 1;
+}
+
+int32_t headingToAzimuth(float heading) {
+    if (heading > 180.0f)
+        heading -= 360.0f;
+    return (int32_t)lroundf(heading * 10000000.0f);
+}
\ No newline at end of file
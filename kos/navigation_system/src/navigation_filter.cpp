@@ -0,0 +1,179 @@
+#include "../include/navigation_filter.h"
+
+#include <math.h>
+
+//Float keeps centimeters up to this distance from the origin
+#define ORIGIN_RANGE_M 10000.0f
+//Measurement further than 5 sigma from the prediction is taken for a glitch,
+//several of them in a row mean the filter is wrong and the axis is restarted from measurements
+#define INNOVATION_GATE 25.0f
+#define MAX_REJECTED_MEASUREMENTS 5
+
+void resetAxis(AxisFilter &axis, float position, float positionVariance) {
+    axis.position = position;
+    axis.velocity = 0.0f;
+    axis.positionVariance = positionVariance;
+    axis.covariance = 0.0f;
+    //Drone can be moving when the filter starts, so velocity is unknown up to a fast flight speed
+    axis.velocityVariance = 100.0f;
+    axis.rejected = 0;
+}
+
+//Constant velocity model, acceleration is the white noise that makes the uncertainty grow
+void predictAxis(AxisFilter &axis, float dt) {
+    float q = NAVIGATION_FILTER_ACCELERATION_NOISE * NAVIGATION_FILTER_ACCELERATION_NOISE;
+    float dt2 = dt * dt;
+    axis.position += axis.velocity * dt;
+    axis.positionVariance += 2 * dt * axis.covariance + dt2 * axis.velocityVariance + q * dt2 * dt2 / 4;
+    axis.covariance += dt * axis.velocityVariance + q * dt2 * dt / 2;
+    axis.velocityVariance += q * dt2;
+}
+
+int gateInnovation(AxisFilter &axis, float innovation, float innovationVariance) {
+    if (innovation * innovation <= INNOVATION_GATE * innovationVariance) {
+        axis.rejected = 0;
+        return 1;
+    }
+    axis.rejected++;
+    return 0;
+}
+
+int updateAxisPosition(AxisFilter &axis, float position, float variance) {
+    float innovation = position - axis.position;
+    float innovationVariance = axis.positionVariance + variance;
+    if (!gateInnovation(axis, innovation, innovationVariance)) {
+        if (axis.rejected < MAX_REJECTED_MEASUREMENTS)
+            return 0;
+        resetAxis(axis, position, variance);
+        return 1;
+    }
+
+    float positionGain = axis.positionVariance / innovationVariance;
+    float velocityGain = axis.covariance / innovationVariance;
+    axis.position += positionGain * innovation;
+    axis.velocity += velocityGain * innovation;
+    axis.velocityVariance -= velocityGain * axis.covariance;
+    axis.positionVariance *= 1.0f - positionGain;
+    axis.covariance *= 1.0f - positionGain;
+    return 1;
+}
+
+int updateAxisVelocity(AxisFilter &axis, float velocity, float variance) {
+    float innovation = velocity - axis.velocity;
+    float innovationVariance = axis.velocityVariance + variance;
+    if (!gateInnovation(axis, innovation, innovationVariance)) {
+        if (axis.rejected < MAX_REJECTED_MEASUREMENTS)
+            return 0;
+        axis.rejected = 0;
+        axis.velocity = velocity;
+        axis.covariance = 0.0f;
+        axis.velocityVariance = variance;
+        return 1;
+    }
+
+    float positionGain = axis.covariance / innovationVariance;
+    float velocityGain = axis.velocityVariance / innovationVariance;
+    axis.position += positionGain * innovation;
+    axis.velocity += velocityGain * innovation;
+    axis.positionVariance -= positionGain * axis.covariance;
+    axis.covariance *= 1.0f - velocityGain;
+    axis.velocityVariance *= 1.0f - velocityGain;
+    return 1;
+}
+
+void setOrigin(NavigationFilter &filter, int32_t latitude, int32_t longitude) {
+    filter.originLatitude = latitude;
+    filter.originLongitude = longitude;
+    filter.metersPerLongitudeUnit = METERS_PER_COORDINATE_UNIT * cosf(latitude * (float)M_PI / 1800000000.0f);
+}
+
+void getFilterCoords(NavigationFilter &filter, int32_t &latitude, int32_t &longitude) {
+    latitude = filter.originLatitude + (int32_t)roundf(filter.north.position / METERS_PER_COORDINATE_UNIT);
+    longitude = filter.originLongitude + (int32_t)roundf(filter.east.position / filter.metersPerLongitudeUnit);
+}
+
+void initNavigationFilter(NavigationFilter &filter) {
+    filter.hasHorizontal = false;
+    filter.hasVertical = false;
+    filter.timeUs = 0;
+    setOrigin(filter, 0, 0);
+}
+
+void predictNavigationFilter(NavigationFilter &filter, uint64_t timeUs) {
+    //Measurements can come a bit out of order from different sensor threads, they are applied at the latest time
+    if (timeUs <= filter.timeUs)
+        return;
+    float dt = (timeUs - filter.timeUs) / 1000000.0f;
+    filter.timeUs = timeUs;
+    if (filter.hasHorizontal) {
+        predictAxis(filter.north, dt);
+        predictAxis(filter.east, dt);
+    }
+    if (filter.hasVertical)
+        predictAxis(filter.up, dt);
+}
+
+int updateNavigationPosition(NavigationFilter &filter, uint64_t timeUs, int32_t latitude, int32_t longitude, float deviation) {
+    predictNavigationFilter(filter, timeUs);
+    float variance = deviation * deviation;
+    if (!filter.hasHorizontal) {
+        setOrigin(filter, latitude, longitude);
+        resetAxis(filter.north, 0.0f, variance);
+        resetAxis(filter.east, 0.0f, variance);
+        filter.hasHorizontal = true;
+        return 1;
+    }
+
+    float north = (latitude - filter.originLatitude) * METERS_PER_COORDINATE_UNIT;
+    float east = (longitude - filter.originLongitude) * filter.metersPerLongitudeUnit;
+    int updated = updateAxisPosition(filter.north, north, variance);
+    updated &= updateAxisPosition(filter.east, east, variance);
+
+    if ((fabsf(filter.north.position) > ORIGIN_RANGE_M) || (fabsf(filter.east.position) > ORIGIN_RANGE_M)) {
+        int32_t originLatitude, originLongitude;
+        getFilterCoords(filter, originLatitude, originLongitude);
+        setOrigin(filter, originLatitude, originLongitude);
+        filter.north.position = 0.0f;
+        filter.east.position = 0.0f;
+    }
+    return updated;
+}
+
+int updateNavigationVelocity(NavigationFilter &filter, uint64_t timeUs, float groundSpeed, float course, float deviation) {
+    if (!filter.hasHorizontal)
+        return 0;
+    predictNavigationFilter(filter, timeUs);
+    float variance = deviation * deviation;
+    float courseRadians = course * (float)M_PI / 180.0f;
+    int updated = updateAxisVelocity(filter.north, groundSpeed * cosf(courseRadians), variance);
+    updated &= updateAxisVelocity(filter.east, groundSpeed * sinf(courseRadians), variance);
+    return updated;
+}
+
+int updateNavigationAltitude(NavigationFilter &filter, uint64_t timeUs, int32_t altitude, float deviation) {
+    predictNavigationFilter(filter, timeUs);
+    float variance = deviation * deviation;
+    if (!filter.hasVertical) {
+        resetAxis(filter.up, altitude / 100.0f, variance);
+        filter.hasVertical = true;
+        return 1;
+    }
+    return updateAxisPosition(filter.up, altitude / 100.0f, variance);
+}
+
+int getFilterSolution(NavigationFilter &filter, NavigationSolution &solution) {
+    if (!filter.hasHorizontal || !filter.hasVertical)
+        return 0;
+    solution.timeUs = filter.timeUs;
+    getFilterCoords(filter, solution.latitude, solution.longitude);
+    solution.altitude = roundf(100.0f * filter.up.position);
+    solution.velocityNorth = filter.north.velocity;
+    solution.velocityEast = filter.east.velocity;
+    solution.velocityUp = filter.up.velocity;
+    const AxisFilter* axes[3] = { &filter.north, &filter.east, &filter.up };
+    for (int i = 0; i < 3; i++) {
+        solution.positionVariance[i] = axes[i]->positionVariance;
+        solution.velocityVariance[i] = axes[i]->velocityVariance;
+    }
+    return 1;
+}
\ No newline at end of file
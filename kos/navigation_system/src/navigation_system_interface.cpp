@@ -1,6 +1,8 @@
 #include "../include/navigation_system.h"
 #include "../include/navigation_system_interface.h"
 
+#include <math.h>
+
 nk_err_t GetCoordsImpl(struct NavigationSystemInterface *self,
                     const NavigationSystemInterface_GetCoords_req *req, const struct nk_arena *reqArena,
                     NavigationSystemInterface_GetCoords_res *res, struct nk_arena *resArena) {
@@ -14,6 +16,19 @@ nk_err_t GetCoordsImpl(struct NavigationSystemInterface *self,
     return NK_EOK;
 }
 
+nk_err_t GetCoordsAtImpl(struct NavigationSystemInterface *self,
+                    const NavigationSystemInterface_GetCoordsAt_req *req, const struct nk_arena *reqArena,
+                    NavigationSystemInterface_GetCoordsAt_res *res, struct nk_arena *resArena) {
+    int32_t latitude, longitude, altitude;
+
+    res->success = getCoordsAt(req->time, latitude, longitude, altitude);
+    res->lat = latitude;
+    res->lng = longitude;
+    res->alt = altitude;
+
+    return NK_EOK;
+}
+
 nk_err_t GetGpsInfoImpl(struct NavigationSystemInterface *self,
                     const NavigationSystemInterface_GetGpsInfo_req *req, const struct nk_arena *reqArena,
                     NavigationSystemInterface_GetGpsInfo_res *res, struct nk_arena *resArena) {
@@ -25,5 +40,18 @@ nk_err_t GetGpsInfoImpl(struct NavigationSystemInterface *self,
     memcpy(&(res->dop), &dop, sizeof(float));
     memcpy(&(res->sats), &sats, sizeof(int32_t));
 
+    return NK_EOK;
+}
+
+nk_err_t GetVelocityImpl(struct NavigationSystemInterface *self,
+                    const NavigationSystemInterface_GetVelocity_req *req, const struct nk_arena *reqArena,
+                    NavigationSystemInterface_GetVelocity_res *res, struct nk_arena *resArena) {
+    float groundSpeed, heading, climbRate;
+
+    res->success = getMotion(groundSpeed, heading, climbRate);
+    res->speed = (int32_t)roundf(groundSpeed * 100.0f);
+    res->heading = headingToAzimuth(heading);
+    res->climb = (int32_t)roundf(climbRate * 100.0f);
+
     return NK_EOK;
 }
\ No newline at end of file
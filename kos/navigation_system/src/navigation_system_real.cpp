@@ -1,4 +1,8 @@
 #include "../include/navigation_system.h"
+#include "../include/bmp280.h"
+#include "../include/nmea_parser.h"
+#include "../include/nmea_reader.h"
+#include "../include/ubx_parser.h"
 #include "../../shared/include/ipc_messages_initialization.h"
 
 #include <coresrv/hal/hal_api.h>
@@ -10,9 +14,9 @@
 #include <thread>
 #include <stdio.h>
 #include <unistd.h>
-#include <math.h>
 
 #define NAME_MAX_LENGTH 64
+#define GPS_READ_TIMEOUT_MS 20
 
 std::thread barometerThread;
 
@@ -24,10 +28,8 @@ char barometerI2C[] = "i2c1";
 char barometerConfigSuffix[] = "p2-3";
 I2cHandle barometerHandler = NULL;
 
-int32_t tempCoefs[3];
-int32_t pressCoefs[9];
-
-float temperatureFine;
+Bmp280Calibration barometerCalibration;
+int32_t temperatureFine;
 
 int writeRegister(uint8_t reg, uint8_t val) {
     I2cMsg messages[1];
@@ -70,10 +72,9 @@ int readRegister16(uint8_t reg, uint8_t* val) {
     return 1;
 }
 
-int readRegister24(uint8_t reg, int32_t &val) {
+int readRegisters(uint8_t reg, uint8_t* values, uint32_t size) {
     I2cMsg messages[2];
     uint8_t writeBuffer[1] = { reg };
-    uint8_t readBuffer[3];
 
     messages[0].addr = 0x76;
     messages[0].flags = 0;
@@ -82,210 +83,90 @@ int readRegister24(uint8_t reg, int32_t &val) {
 
     messages[1].addr = 0x76;
     messages[1].flags = I2C_FLAG_RD;
-    messages[1].buf = readBuffer;
-    messages[1].len = 3;
+    messages[1].buf = values;
+    messages[1].len = size;
 
     I2cError rc = I2cXfer(barometerHandler, 400000, messages, 2);
     if (rc != rcOk)
         return 0;
 
-    val = ((int32_t)(readBuffer[0]) << 12) | ((int32_t)(readBuffer[1]) << 4) | ((int32_t)(readBuffer[2]) >> 4);
     return 1;
 }
 
-int getTemperature(float &temperature) {
-    int32_t temp;
-    if (!readRegister24(0xFA, temp))
+int getBarometerSample(int32_t &temperature, uint32_t &pressure) {
+    uint8_t data[BMP280_DATA_SIZE];
+    if (!readRegisters(BMP280_DATA_REGISTER, data, BMP280_DATA_SIZE))
         return 0;
 
-    double tempFst = (temp / 16384.0 - tempCoefs[0] / 1024.0) * tempCoefs[1];
-    double tempSnd = pow(temp / 131072.0 - tempCoefs[0] / 8192.0, 2) * tempCoefs[2];
-
-    temperatureFine = tempFst + tempSnd;
-    temperature = temperatureFine / 5120.0;
-
-    return 1;
-}
-
-int getPressure(float &pressure) {
-    int32_t press;
-    if (!readRegister24(0xF7, press))
-        return 0;
-
-    double pressFst = (temperatureFine / 2.0) - 64000.0;
-    double pressSnd = pow(pressFst, 2) * pressCoefs[5] / 32768.0;
-    pressSnd += pressFst * pressCoefs[4] * 2.0;
-    pressSnd = (pressSnd / 4.0) + (pressCoefs[3] * 65536.0);
-    pressFst = (pressCoefs[2] * pow(pressFst, 2) / 524288.0 + pressFst * pressCoefs[1]) / 524288.0;
-    pressFst = (1.0 + pressFst / 32768.0) * pressCoefs[0];
-
-    double pressTrd = 1048576.0 - press;
-    pressTrd = (pressTrd - (pressSnd / 4096.0)) * 6250.0 / pressFst;
-    pressFst = pressCoefs[8] * pow(pressTrd, 2) / 2147483648.0;
-    pressSnd = pressTrd * pressCoefs[7] / 32768.0;
-
-    pressure = pressTrd + (pressFst + pressSnd + pressCoefs[6]) / 16.0;
-
-    return 1;
+    int32_t rawPressure, rawTemperature;
+    parseBmp280Data(data, rawPressure, rawTemperature);
+    temperature = compensateBmp280Temperature(barometerCalibration, rawTemperature, temperatureFine);
+    pressure = compensateBmp280Pressure(barometerCalibration, rawPressure, temperatureFine);
+    return (pressure != 0);
 }
 
 void getBarometer() {
     while (true) {
-        float temp, press;
-        getTemperature(temp);
-        getPressure(press);
-        float alt = 44330.0 * (1.0 - pow(press / 101325.0, 0.1903));
-        int32_t altitude = 100 * alt;
-        setAltitude(altitude);
-        usleep(500000);
+        int32_t temp;
+        uint32_t press;
+        if (getBarometerSample(temp, press))
+            setAltitude(pressureToAltitude(press));
+        usleep(1000000 / BAROMETER_RATE_HZ);
+    }
+}
+
+//Accuracy goes first, so the position of the same epoch is weighted by it
+void publishGpsFix(GpsFix &fix) {
+    if (fix.updated & GPS_ACCURACY_UPDATED)
+        setGpsAccuracy(fix.horizontalAccuracy);
+    if (fix.updated & GPS_POSITION_UPDATED) {
+        setGpsInfo(fix.hdop, fix.sats);
+        setCoords(fix.latitude, fix.longitude);
     }
+    if (fix.updated & GPS_VELOCITY_UPDATED)
+        setGpsVelocity(fix.groundSpeed, fix.course);
+    fix.updated = 0;
 }
 
 void getSensors() {
-    bool read, update;
-    uint8_t value;
-    int mode, idx, latSign, lngSign;
-    int32_t latitude, longitude;
-    char head[8], satsStr[8], dopStr[8], latStr[16], lngStr[16];
+    NmeaReader reader;
+    initNmeaReader(reader);
+    GpsFix fix;
+    initGpsFix(fix);
+#ifdef GPS_UBX
+    uint8_t frameCopy[UBX_MAX_FRAME_SIZE];
+    const uint8_t* frame;
+#else
+    char sentence[NMEA_MAX_SENTENCE_LENGTH + 1];
+#endif
+    uint32_t length;
+    //Read returns what has arrived when the GPS pauses between epochs, so a fix is not held in the driver
+    rtl_timespec_t timeout = { 0, GPS_READ_TIMEOUT_MS * 1000000 };
 
     while (true) {
-        update = true;
-        read = true;
-        mode = 0;
-        idx = 0;
-
-        while (read) {
-            Retcode rc = UartReadByte(gpsUartHandler, &value);
-            if (rc != rcOk)
-                continue;
-            switch (mode) {
-            case 0:
-                if (value == '$')
-                    mode = 1;
-                break;
-            case 1: //Header
-                if (idx >= 8) {
-                    read = false;
-                    update = false;
-                }
-                else if (value == ',') {
-                    head[idx] = '\0';
-                    if ((head[2] == 'G') && (head[3] == 'G') && (head[4] == 'A'))
-                        mode = 2;
-                    else
-                        mode = 0;
-                    idx = 0;
-                }
-                else {
-                    head[idx] = value;
-                    idx++;
-                }
-                break;
-            case 2: //UTC time
-            case 7: //Quality
-                if (value == ',')
-                    mode++;
-                break;
-            case 3: //Lat
-                if (idx >= 16) {
-                    read = false;
-                    update = false;
-                }
-                else if (value == ',') {
-                    latStr[idx] = '\0';
-                    idx = 0;
-                    mode = 4;
-                }
-                else {
-                    latStr[idx] = value;
-                    idx++;
-                }
-                break;
-            case 4: //Lat dir
-                if (value == 'N')
-                    latSign = 1;
-                else if (value == 'S')
-                    latSign = -1;
-                else if (value == ',')
-                    mode = 5;
-                else {
-                    read = false;
-                    update = false;
-                }
-                break;
-            case 5: //Lng
-                if (idx >= 16) {
-                    read = false;
-                    update = false;
-                }
-                else if (value == ',') {
-                    lngStr[idx] = '\0';
-                    idx = 0;
-                    mode = 6;
-                }
-                else {
-                    lngStr[idx] = value;
-                    idx++;
-                }
-                break;
-            case 6: //Lng dir
-                if (value == 'E')
-                    lngSign = 1;
-                else if (value == 'W')
-                    lngSign = -1;
-                else if (value == ',')
-                    mode = 7;
-                else {
-                    read = false;
-                    update = false;
-                }
-                break;
-            case 8: //Sats
-                if (idx >= 8) {
-                    read = false;
-                    update = false;
-                }
-                else if (value == ',') {
-                    satsStr[idx] = '\0';
-                    idx = 0;
-                    mode = 9;
-                }
-                else {
-                    satsStr[idx] = value;
-                    idx++;
-                }
-                break;
-            case 9: //Hdop
-                if (idx >= 8) {
-                    read = false;
-                    update = false;
-                }
-                else if (value == ',') {
-                    dopStr[idx] = '\0';
-                    idx = 0;
-                    read = false;
-                }
-                else {
-                    dopStr[idx] = value;
-                    idx++;
-                }
-                break;
-            }
+        uint32_t freeSize;
+        uint8_t* freeSpace = getNmeaWriteSpace(reader, freeSize);
+        rtl_size_t readBytes = 0;
+        Retcode rc = UartRead(gpsUartHandler, freeSpace, freeSize, &timeout, &readBytes);
+        if ((rc != rcOk) && (rc != rcTimeout))
+            continue;
+        commitNmeaWrite(reader, readBytes);
+
+#ifdef GPS_UBX
+        while ((frame = nextUbxFrame(reader, frameCopy, length)) != NULL) {
+            if (!parseUbxFrame(frame, length, fix))
+                fprintf(stderr, "[%s] Warning: Failed to parse UBX message from GPS\n", ENTITY_NAME);
+            else
+                publishGpsFix(fix);
         }
-
-        if (update) {
-            longitude = round(10000000 * atof(lngStr + 3) / 60.0f);
-            latitude = round(10000000 * atof(latStr + 2) / 60.0f);
-            lngStr[3] = '\0';
-            latStr[2] = '\0';
-            longitude += 10000000 * atoi(lngStr);
-            latitude += 10000000 * atoi(latStr);
-
-            setCoords(latitude, longitude);
-            setGpsInfo(atof(dopStr), atoi(satsStr));
+#else
+        while (nextNmeaSentence(reader, sentence, length)) {
+            if (!parseNmeaSentence(sentence, length, fix))
+                fprintf(stderr, "[%s] Warning: Failed to parse NMEA string from GPS\n", ENTITY_NAME);
+            else
+                publishGpsFix(fix);
         }
-        else
-            fprintf(stderr, "[%s] Warning: Failed to parse NMEA string from GPS\n", ENTITY_NAME);
+#endif
     }
 }
 
@@ -352,6 +233,20 @@ int initNavigationSystem() {
     return 1;
 }
 
+int writeGpsMessage(uint8_t* message, ssize_t expectedSize) {
+    rtl_size_t writtenBytes;
+    Retcode rc = UartWrite(gpsUartHandler, message, expectedSize, NULL, &writtenBytes);
+    if (rc != rcOk) {
+        fprintf(stderr, "[%s] Warning: Failed to write configuration message to GPS ("RETCODE_HR_FMT")\n", ENTITY_NAME, RETCODE_HR_PARAMS(rc));
+        return 0;
+    }
+    else if (writtenBytes != expectedSize) {
+        fprintf(stderr, "[%s] Warning: Failed to write configuration message to GPS: %ld bytes were expected, %ld bytes were sent\n", ENTITY_NAME, expectedSize, writtenBytes);
+        return 0;
+    }
+    return 1;
+}
+
 int initSensors() {
     Retcode rc = UartOpenPort(gpsUart, &gpsUartHandler);
     if (rc != rcOk) {
@@ -359,36 +254,25 @@ int initSensors() {
         return 0;
     }
 
-    rtl_size_t writtenBytes;
     uint8_t gnssNmea[] = { 0xb5, 0x62,
         0x06, 0x00, 0x14, 0x00, 0x01, 0x00, 0x00, 0x00, 0xd0, 0x08, 0x00, 0x00, 0x00, 0xc2, 0x01, 0x00,
         0x03, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0xbb, 0x58 };
-    ssize_t expectedSize = sizeof(gnssNmea);
-    rc = UartWrite(gpsUartHandler, gnssNmea, expectedSize, NULL, &writtenBytes);
-    if (rc != rcOk) {
-        fprintf(stderr, "[%s] Warning: Failed to write configuration message to GPS ("RETCODE_HR_FMT")\n", ENTITY_NAME, RETCODE_HR_PARAMS(rc));
+    if (!writeGpsMessage(gnssNmea, sizeof(gnssNmea)))
         return 0;
-    }
-    else if (writtenBytes != expectedSize) {
-        fprintf(stderr, "[%s] Warning: Failed to write configuration message to GPS: %ld bytes were expected, %ld bytes were sent\n", ENTITY_NAME, expectedSize, writtenBytes);
-        return 0;
-    }
     uint8_t gnssSystems[] =  { 0xb5, 0x62,
         0x06, 0x8a, 0x4a, 0x00, 0x00, 0x07, 0x00, 0x00, 0x1f, 0x00, 0x31, 0x10, 0x01, 0x01, 0x00, 0x31,
         0x10, 0x01, 0x20, 0x00, 0x31, 0x10, 0x00, 0x05, 0x00, 0x31, 0x10, 0x00, 0x21, 0x00, 0x31, 0x10,
         0x01, 0x07, 0x00, 0x31, 0x10, 0x01, 0x22, 0x00, 0x31, 0x10, 0x00, 0x0d, 0x00, 0x31, 0x10, 0x00,
         0x0f, 0x00, 0x31, 0x10, 0x00, 0x24, 0x00, 0x31, 0x10, 0x00, 0x12, 0x00, 0x31, 0x10, 0x00, 0x14,
         0x00, 0x31, 0x10, 0x00, 0x25, 0x00, 0x31, 0x10, 0x01, 0x18, 0x00, 0x31, 0x10, 0x01, 0xa7, 0x51 };
-    expectedSize = sizeof(gnssSystems);
-    rc = UartWrite(gpsUartHandler, gnssSystems, expectedSize, NULL, &writtenBytes);
-    if (rc != rcOk) {
-        fprintf(stderr, "[%s] Warning: Failed to write configuration message to GPS ("RETCODE_HR_FMT")\n", ENTITY_NAME, RETCODE_HR_PARAMS(rc));
+    if (!writeGpsMessage(gnssSystems, sizeof(gnssSystems)))
         return 0;
-    }
-    else if (writtenBytes != expectedSize) {
-        fprintf(stderr, "[%s] Warning: Failed to write configuration message to GPS: %ld bytes were expected, %ld bytes were sent\n", ENTITY_NAME, expectedSize, writtenBytes);
+#ifdef GPS_UBX
+    //Port is switched from NMEA to NAV-PVT frames, the reader skips text that is still in flight
+    uint8_t navPvtConfig[UBX_MAX_FRAME_SIZE];
+    if (!writeGpsMessage(navPvtConfig, makeUbxNavPvtConfig(1000 / GPS_UBX_RATE_HZ, navPvtConfig)))
         return 0;
-    }
+#endif
 
     rc = I2cOpenChannel(barometerI2C, &barometerHandler);
     if (rc != rcOk) {
@@ -396,11 +280,13 @@ int initSensors() {
         return 0;
     }
 
-    if (!writeRegister(0xF5, 0x90)) {
+    if (getBmp280MeasurementTimeUs() > 1000000 / BAROMETER_RATE_HZ)
+        fprintf(stderr, "[%s] Warning: Barometer cannot give %d samples per second with chosen oversampling\n", ENTITY_NAME, BAROMETER_RATE_HZ);
+    if (!writeRegister(0xF5, getBmp280ConfigRegister(1000000 / BAROMETER_RATE_HZ))) {
         fprintf(stderr, "[%s] Warning: Failed to set barometer filter\n", ENTITY_NAME);
         return 0;
     }
-    if (!writeRegister(0xF4, 0x57)) {
+    if (!writeRegister(0xF4, getBmp280ControlRegister())) {
         fprintf(stderr, "[%s] Warning: Failed to set barometer sampling rates\n", ENTITY_NAME);
         return 0;
     }
@@ -414,12 +300,12 @@ int initSensors() {
         if (i) {
             int16_t signedValue;
             memcpy(&signedValue, &value, sizeof(int16_t));
-            tempCoefs[i] = signedValue;
+            barometerCalibration.temperature[i] = signedValue;
         }
         else {
             uint16_t unsignedValue;
             memcpy(&unsignedValue, &value, sizeof(uint16_t));
-            tempCoefs[i] = unsignedValue;
+            barometerCalibration.temperature[i] = unsignedValue;
         }
     }
 
@@ -432,15 +318,16 @@ int initSensors() {
         if (i) {
             int16_t signedValue;
             memcpy(&signedValue, &value, sizeof(int16_t));
-            pressCoefs[i] = signedValue;
+            barometerCalibration.pressure[i] = signedValue;
         }
         else {
             uint16_t unsignedValue;
             memcpy(&unsignedValue, &value, sizeof(uint16_t));
-            pressCoefs[i] = unsignedValue;
+            barometerCalibration.pressure[i] = unsignedValue;
         }
     }
 
+    initAltitudeTable();
     barometerThread = std::thread(getBarometer);
 
     return 1;
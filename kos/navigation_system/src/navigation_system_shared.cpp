@@ -4,6 +4,8 @@
 
 #include <unistd.h>
 #include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
 #include <math.h>
 #include <mutex>
 
@@ -11,50 +13,191 @@ std::mutex sensorMutex;
 
 bool hasAlt = false;
 bool hasCoords = false;
+bool hasVelocity = false;
+bool hasAccuracy = false;
 
 float sensorDop = 0.0f;
 int32_t sensorSats = 0;
 int32_t sensorLatitude = 0;
 int32_t sensorLongitude = 0;
 int32_t sensorAltitude = 0;
+float sensorGroundSpeed = 0.0f;
+float sensorCourse = 0.0f;
+float sensorAccuracy = 0.0f;
+
+//Written with sensorMutex locked, read without it
+PositionHistory positionHistory;
+MotionEstimator motionEstimator;
+
+//Has to be called with sensorMutex locked
+void addPosition(uint64_t timeUs, int32_t latitude, int32_t longitude, int32_t altitude) {
+    storePosition(positionHistory, timeUs, latitude, longitude, altitude);
+    updateMotionEstimator(motionEstimator, positionHistory);
+}
+
+#ifdef NAVIGATION_FILTER
+NavigationFilter navigationFilter;
+NavigationSolution navigationSolution;
+bool filterInitialized = false;
+bool hasSolution = false;
+
+//Has to be called with sensorMutex locked, sensors can deliver measurements before the filter thread starts
+NavigationFilter& getFilter() {
+    if (!filterInitialized) {
+        initNavigationFilter(navigationFilter);
+        filterInitialized = true;
+    }
+    return navigationFilter;
+}
+
+void runNavigationFilter() {
+    while (true) {
+        sensorMutex.lock();
+        NavigationFilter &filter = getFilter();
+        predictNavigationFilter(filter, getPositionTimeUs());
+        if (getFilterSolution(filter, navigationSolution)) {
+            hasSolution = true;
+            addPosition(navigationSolution.timeUs, navigationSolution.latitude, navigationSolution.longitude, navigationSolution.altitude);
+        }
+        sensorMutex.unlock();
+        usleep(1000000 / NAVIGATION_FILTER_RATE_HZ);
+    }
+}
+
+int getNavigationSolution(NavigationSolution &solution) {
+    std::lock_guard<std::mutex> lock(sensorMutex);
+    solution = navigationSolution;
+    return hasSolution;
+}
+#endif
 
 bool hasPosition() {
     return (hasAlt && hasCoords);
 }
 
-void sendCoords() {
+//Horizontal distance in meters, points are close enough to take the Earth for flat between them
+float getDistance(int32_t fromLatitude, int32_t fromLongitude, int32_t toLatitude, int32_t toLongitude) {
+    float north = (toLatitude - fromLatitude) * METERS_PER_COORDINATE_UNIT;
+    float east = (toLongitude - fromLongitude) * METERS_PER_COORDINATE_UNIT * cosf(fromLatitude * (float)M_PI / 1800000000.0f);
+    return sqrtf(north * north + east * east);
+}
+
+//Heading is only compared while the drone moves fast enough for it to be updated
+bool getHeading(float &heading) {
+    float groundSpeed, climbRate;
+    return (getMotion(groundSpeed, heading, climbRate) && (groundSpeed >= MOTION_MIN_HEADING_SPEED));
+}
+
+bool needTelemetry(uint64_t elapsedUs, float distance, int32_t climb, bool turned) {
+    if (elapsedUs < TELEMETRY_MIN_INTERVAL_MS * 1000ull)
+        return false;
+    return ((elapsedUs >= TELEMETRY_MAX_INTERVAL_MS * 1000ull) || (distance >= TELEMETRY_DISTANCE_M) || (abs(climb) >= TELEMETRY_ALTITUDE_CM) || turned);
+}
+
+#ifdef TELEMETRY_TREE
+//Sample is not signed, it is confirmed later by the signed root of its batch. It is added to the tree only
+//after the server has got it, and the root goes after the samples of its batch, so both trees stay the same
+bool sendTreeSample(char* sample, char* root, char* response) {
+    char request[1024] = {0};
     char signature[257] = {0};
+    uint32_t batch, index;
+
+    //Root that was not delivered is sent before the samples of the next batch
+    if (root[0]) {
+        if (!sendRequest(root, response)) {
+            fprintf(stderr, "[%s] Warning: Failed to send 'telemetry root' request through Server Connector. Trying again in %dms\n", ENTITY_NAME, TELEMETRY_MIN_INTERVAL_MS);
+            return false;
+        }
+        root[0] = '\0';
+    }
+
+    if (!appendTelemetry(sample, batch, index)) {
+        fprintf(stderr, "[%s] Warning: Failed to add 'coordinate' message to telemetry tree at Credential Manager. Trying again in %dms\n", ENTITY_NAME, TELEMETRY_MIN_INTERVAL_MS);
+        return false;
+    }
+    //Samples have their own endpoint, so Server Connector neither coalesces nor defers them
+    snprintf(request, 1024, "/api/telemetry_sample%s&batch=%u&leaf=%u", sample + strlen("/api/telemetry"), batch, index);
+    if (!sendRequest(request, response)) {
+        fprintf(stderr, "[%s] Warning: Failed to send 'coordinate' request through Server Connector. Trying again in %dms\n", ENTITY_NAME, TELEMETRY_MIN_INTERVAL_MS);
+        return false;
+    }
+    if (!confirmTelemetry(batch, index, root, signature)) {
+        fprintf(stderr, "[%s] Warning: Failed to confirm 'coordinate' message at Credential Manager\n", ENTITY_NAME);
+        root[0] = '\0';
+        return false;
+    }
+
+    if (root[0]) {
+        snprintf(root + strlen(root), 1024 - strlen(root), "&sig=0x%s", signature);
+        if (!sendRequest(root, response))
+            fprintf(stderr, "[%s] Warning: Failed to send 'telemetry root' request through Server Connector\n", ENTITY_NAME);
+        else
+            root[0] = '\0';
+    }
+    return true;
+}
+#endif
+
+void sendCoords() {
     char request[1024] = {0};
     char response[1024] = {0};
+#ifdef TELEMETRY_TREE
+    char root[1024] = {0};
+#else
+    char signature[257] = {0};
+#endif
 
-    float dop;
-    int32_t prevLat, prevLng, lat, lng, alt, azimuth, sats;
-    while (!getCoords(prevLat, prevLng, alt)) {
+    float dop, heading = 0.0f, sentHeading = 0.0f;
+    int32_t prevLat, prevLng, prevAlt, lat, lng, alt, azimuth, sats;
+    while (!getCoords(prevLat, prevLng, prevAlt)) {
         fprintf(stderr, "[%s] Warning: Failed to get coords from Navigation System. Trying again in 1s\n", ENTITY_NAME);
         sleep(1);
     }
+    //First sample is sent as soon as it is received
+    uint64_t sentUs = getPositionTimeUs() - TELEMETRY_MAX_INTERVAL_MS * 1000ull;
+    bool hasSentHeading = false;
 
     while (true) {
         if (!getCoords(lat, lng, alt))
-            fprintf(stderr, "[%s] Warning: Failed to get GPS coords. Trying again in 500ms\n", ENTITY_NAME);
+            fprintf(stderr, "[%s] Warning: Failed to get GPS coords. Trying again in %dms\n", ENTITY_NAME, TELEMETRY_MIN_INTERVAL_MS);
         else {
             if (!getGpsInfo(dop, sats))
-                fprintf(stderr, "[%s] Warning: Failed to get GPS's sats and dop. Trying again in 500ms\n", ENTITY_NAME);
+                fprintf(stderr, "[%s] Warning: Failed to get GPS's sats and dop. Trying again in %dms\n", ENTITY_NAME, TELEMETRY_MIN_INTERVAL_MS);
             else {
-                azimuth = round(atan2(lng - prevLng, lat - prevLat) * 1800000000 / M_PI);
-                prevLat = lat;
-                prevLng = lng;
-                snprintf(request, 1024, "/api/telemetry?%s&lat=%d&lon=%d&alt=%d&azimuth=%d&dop=%f&sats=%d", BOARD_ID, lat, lng, alt, azimuth, dop, sats);
-                if (!signMessage(request, signature))
-                    fprintf(stderr, "[%s] Warning: Failed to sign 'coordinate' message at Credential Manager. Trying again in 500ms\n", ENTITY_NAME);
-                else {
-                    snprintf(request, 1024, "%s&sig=0x%s", request, signature);
-                    if (!sendRequest(request, response))
-                        fprintf(stderr, "[%s] Warning: Failed to send 'coordinate' request through Server Connector. Trying again in 500ms\n", ENTITY_NAME);
+                uint64_t timeUs = getPositionTimeUs();
+                bool hasHeading = getHeading(heading);
+                bool turned = hasHeading && hasSentHeading && (fabsf(fmodf(heading - sentHeading + 540.0f, 360.0f) - 180.0f) >= TELEMETRY_HEADING_DEG);
+                if (needTelemetry(timeUs - sentUs, getDistance(prevLat, prevLng, lat, lng), alt - prevAlt, turned)) {
+                    bool sent = false;
+                    //Heading is the last known one while the drone hovers
+                    azimuth = headingToAzimuth(heading);
+                    snprintf(request, 1024, "/api/telemetry?%s&lat=%d&lon=%d&alt=%d&azimuth=%d&dop=%f&sats=%d", BOARD_ID, lat, lng, alt, azimuth, dop, sats);
+#ifdef TELEMETRY_TREE
+                    sent = sendTreeSample(request, root, response);
+#else
+                    if (!signMessage(request, signature))
+                        fprintf(stderr, "[%s] Warning: Failed to sign 'coordinate' message at Credential Manager. Trying again in %dms\n", ENTITY_NAME, TELEMETRY_MIN_INTERVAL_MS);
+                    else {
+                        snprintf(request, 1024, "%s&sig=0x%s", request, signature);
+                        if (!sendRequest(request, response))
+                            fprintf(stderr, "[%s] Warning: Failed to send 'coordinate' request through Server Connector. Trying again in %dms\n", ENTITY_NAME, TELEMETRY_MIN_INTERVAL_MS);
+                        else
+                            sent = true;
+                    }
+#endif
+                    //Changes are measured from the sample the server has got, so a lost one is sent again
+                    if (sent) {
+                        sentUs = timeUs;
+                        prevLat = lat;
+                        prevLng = lng;
+                        prevAlt = alt;
+                        sentHeading = heading;
+                        hasSentHeading = hasHeading;
+                    }
                 }
             }
         }
-        usleep(500000);
+        usleep(TELEMETRY_MIN_INTERVAL_MS * 1000);
     }
 }
 
@@ -80,9 +223,48 @@ int getGpsInfo(float& dop, int32_t& sats) {
     }
 }
 
+void setGpsVelocity(float groundSpeed, float course) {
+    sensorMutex.lock();
+    sensorGroundSpeed = groundSpeed;
+    sensorCourse = course;
+    hasVelocity = true;
+#ifdef NAVIGATION_FILTER
+    updateNavigationVelocity(getFilter(), getPositionTimeUs(), groundSpeed, course, NAVIGATION_FILTER_VELOCITY_NOISE);
+#endif
+    sensorMutex.unlock();
+}
+
+//Velocity is only known when the receiver reports it, otherwise it has to be found from positions
+int getGpsVelocity(float &groundSpeed, float &course) {
+    sensorMutex.lock();
+    groundSpeed = sensorGroundSpeed;
+    course = sensorCourse;
+    bool known = hasVelocity;
+    sensorMutex.unlock();
+    return known;
+}
+
+void setGpsAccuracy(float horizontalAccuracy) {
+    sensorMutex.lock();
+    sensorAccuracy = horizontalAccuracy;
+    hasAccuracy = true;
+    sensorMutex.unlock();
+}
+
+int getGpsAccuracy(float &horizontalAccuracy) {
+    sensorMutex.lock();
+    horizontalAccuracy = sensorAccuracy;
+    bool known = hasAccuracy;
+    sensorMutex.unlock();
+    return known;
+}
+
 void setAltitude(int32_t altitude) {
     sensorMutex.lock();
     sensorAltitude = altitude;
+#ifdef NAVIGATION_FILTER
+    updateNavigationAltitude(getFilter(), getPositionTimeUs(), altitude, NAVIGATION_FILTER_BAROMETER_NOISE);
+#endif
     sensorMutex.unlock();
     if (!hasAlt && (altitude != 0)) {
         hasAlt = true;
@@ -95,6 +277,17 @@ void setCoords(int32_t latitude, int32_t longitude) {
     sensorMutex.lock();
     sensorLatitude = latitude;
     sensorLongitude = longitude;
+#ifdef NAVIGATION_FILTER
+    //Accuracy reported by the receiver is preferred to the one guessed from HDOP
+    float deviation = hasAccuracy ? sensorAccuracy : (sensorDop * NAVIGATION_FILTER_GPS_NOISE);
+    if (deviation <= 0.0f)
+        deviation = NAVIGATION_FILTER_GPS_NOISE;
+    updateNavigationPosition(getFilter(), getPositionTimeUs(), latitude, longitude, deviation);
+#else
+    //Barometer altitude is the latest one, it is measured more often than GPS fixes
+    if (hasAlt)
+        addPosition(getPositionTimeUs(), latitude, longitude, sensorAltitude);
+#endif
     sensorMutex.unlock();
     if (!hasCoords && (latitude != 0) && (longitude != 0)) {
         hasCoords = true;
@@ -109,6 +302,13 @@ int getCoords(int32_t &latitude, int32_t &longitude, int32_t &altitude) {
         latitude = sensorLatitude;
         longitude = sensorLongitude;
         altitude = sensorAltitude;
+#ifdef NAVIGATION_FILTER
+        if (hasSolution) {
+            latitude = navigationSolution.latitude;
+            longitude = navigationSolution.longitude;
+            altitude = navigationSolution.altitude;
+        }
+#endif
         sensorMutex.unlock();
         return 1;
     }
@@ -118,4 +318,29 @@ int getCoords(int32_t &latitude, int32_t &longitude, int32_t &altitude) {
         altitude = 0;
         return 0;
     }
+}
+
+int getCoordsAt(uint64_t time, int32_t &latitude, int32_t &longitude, int32_t &altitude) {
+    PositionSample sample;
+    if (!getPositionAt(positionHistory, time, sample)) {
+        latitude = 0;
+        longitude = 0;
+        altitude = 0;
+        return 0;
+    }
+    latitude = sample.latitude;
+    longitude = sample.longitude;
+    altitude = sample.altitude;
+    return 1;
+}
+
+int getMotion(float &groundSpeed, float &heading, float &climbRate) {
+    sensorMutex.lock();
+    groundSpeed = motionEstimator.groundSpeed;
+    heading = motionEstimator.heading;
+    climbRate = motionEstimator.velocityUp;
+    //Estimate is not extrapolated over the gaps the history does not interpolate
+    bool known = motionEstimator.hasVelocity && (getPositionTimeUs() - motionEstimator.timeUs <= POSITION_HISTORY_MAX_GAP_MS * 1000ull);
+    sensorMutex.unlock();
+    return known;
 }
\ No newline at end of file
@@ -1,5 +1,5 @@
 #include "../include/navigation_system.h"
-#include "../include/sim_sensor_data_message.h"
+#include "../include/sim_sensor_reader.h"
 
 #include <kos_net.h>
 
@@ -9,35 +9,34 @@ int simSensorSocket = NULL;
 uint16_t simSensorPort = 5766;
 
 void getSensors() {
-    bool restart;
-    uint8_t message[sizeof(SimSensorDataMessage)];
+    static SimSensorReader reader;
+    initSimSensorReader(reader);
+    SimSensorDataMessage message;
+    uint32_t resyncs = 0;
 
     while (true) {
-        restart = false;
-        for (int i = 0; i < SIM_SENSOR_DATA_MESSAGE_HEAD_SIZE; i++) {
-            if (read(simSensorSocket, message + i, 1) != 1) {
-                fprintf(stderr, "[%s] Warning: Failed to read from socket\n", ENTITY_NAME);
-                restart = true;
-                break;
-            }
-
-            if (message[i] != SimSensorDataMessageHead[i]) {
-                fprintf(stderr, "[%s] Warning: Received message has an unknown header\n", ENTITY_NAME);
-                restart = true;
-                break;
-            }
+        uint32_t freeSize;
+        uint8_t* freeSpace = getSimSensorWriteSpace(reader, freeSize);
+        ssize_t readBytes = read(simSensorSocket, freeSpace, freeSize);
+        if (readBytes <= 0) {
+            fprintf(stderr, "[%s] Warning: Failed to read from socket\n", ENTITY_NAME);
+            continue;
         }
+        commitSimSensorWrite(reader, readBytes);
 
-        if (!restart) {
-            ssize_t expectedSize = sizeof(SimSensorDataMessage) - SIM_SENSOR_DATA_MESSAGE_HEAD_SIZE;
-            ssize_t readBytes = read(simSensorSocket, message + SIM_SENSOR_DATA_MESSAGE_HEAD_SIZE, expectedSize);
-            if (readBytes == expectedSize) {
-                SimSensorDataMessage *data = (SimSensorDataMessage*)message;
-                setCoords(data->latitude, data->longitude);
-                setAltitude(data->altitude);
-            }
-            else
-                fprintf(stderr, "[%s] Warning: Failed to read message from autopilot: %ld bytes were expected, %ld bytes were received\n", ENTITY_NAME, expectedSize, readBytes);
+        //Messages of one read arrive at the same moment and would get the same timestamp in the position history,
+        //so only the newest one of them is published
+        bool received = false;
+        while (nextSimSensorMessage(reader, message))
+            received = true;
+        if (received) {
+            setCoords(message.latitude, message.longitude);
+            setAltitude(message.altitude);
+        }
+        if (reader.resyncs != resyncs) {
+            resyncs = reader.resyncs;
+            fprintf(stderr, "[%s] Warning: Received message has an unknown header, stream is resynchronized (%u times, %u bytes are skipped)\n",
+                ENTITY_NAME, reader.resyncs, reader.droppedBytes);
         }
     }
 }
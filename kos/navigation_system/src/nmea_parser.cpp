@@ -0,0 +1,191 @@
+#include "../include/nmea_parser.h"
+#include "../../shared/include/hex_codec.h"
+
+#include <string.h>
+#include <math.h>
+
+#define NMEA_MAX_FIELDS 24
+#define NMEA_MAX_SCALE 10000000
+#define KNOTS_TO_METERS_PER_SECOND 0.514444f
+#define KMH_TO_METERS_PER_SECOND (1.0f / 3.6f)
+
+typedef int (*NmeaFieldsParser)(char** fields, int number, GpsFix &fix);
+
+struct NmeaSentenceType {
+    const char* type;
+    int minFields;
+    NmeaFieldsParser parse;
+};
+
+//Sentence is split in place, fields point into it
+int splitNmeaFields(char* sentence, char** fields, int maxFields) {
+    int number = 0;
+    char* field = sentence;
+    while (number < maxFields) {
+        fields[number++] = field;
+        field = strchr(field, ',');
+        if (field == NULL)
+            break;
+        *field++ = '\0';
+    }
+    return number;
+}
+
+//Fields are short unsigned decimals, so they are read as integers scaled by a power of ten without strtod
+uint64_t parseNmeaDecimal(const char* value, uint64_t &scale) {
+    uint64_t number = 0;
+    scale = 1;
+    for (; (*value >= '0') && (*value <= '9'); value++)
+        number = 10 * number + (*value - '0');
+    if (*value == '.')
+        for (value++; (*value >= '0') && (*value <= '9') && (scale < NMEA_MAX_SCALE); value++) {
+            number = 10 * number + (*value - '0');
+            scale *= 10;
+        }
+    return number;
+}
+
+float parseNmeaFloat(const char* value) {
+    bool negative = (*value == '-');
+    uint64_t scale;
+    float number = (float)parseNmeaDecimal(value + negative, scale) / scale;
+    return negative ? -number : number;
+}
+
+//Coordinate is sent as degrees followed by minutes, degrees take the given number of digits
+int32_t parseNmeaCoordinate(const char* value, int degreeDigits, const char* hemisphere) {
+    int32_t degrees = 0;
+    for (int i = 0; i < degreeDigits; i++)
+        degrees = 10 * degrees + (value[i] - '0');
+    uint64_t scale;
+    uint64_t minutes = parseNmeaDecimal(value + degreeDigits, scale);
+    //Minutes are turned into 1e-7 degrees with rounding to the nearest
+    int32_t coordinate = 10000000 * degrees + (int32_t)((minutes * 20000000 / (60 * scale) + 1) / 2);
+    return ((hemisphere[0] == 'S') || (hemisphere[0] == 'W')) ? -coordinate : coordinate;
+}
+
+uint32_t parseNmeaTime(const char* value) {
+    if (strlen(value) < 6)
+        return 0;
+    uint32_t hours = 10 * (value[0] - '0') + (value[1] - '0');
+    uint32_t minutes = 10 * (value[2] - '0') + (value[3] - '0');
+    uint64_t scale;
+    uint64_t seconds = parseNmeaDecimal(value + 4, scale);
+    return 3600000 * hours + 60000 * minutes + (uint32_t)(1000 * seconds / scale);
+}
+
+int parseGgaFields(char** fields, int /*number*/, GpsFix &fix) {
+    uint64_t scale;
+    fix.time = parseNmeaTime(fields[1]);
+    fix.sats = parseNmeaDecimal(fields[7], scale);
+    //Receiver without a fix leaves position fields empty
+    fix.valid = (fields[6][0] > '0') && (strlen(fields[2]) >= 4) && (strlen(fields[4]) >= 5);
+    if (!fix.valid)
+        return 1;
+
+    fix.latitude = parseNmeaCoordinate(fields[2], 2, fields[3]);
+    fix.longitude = parseNmeaCoordinate(fields[4], 3, fields[5]);
+    fix.altitude = round(100 * parseNmeaFloat(fields[9]));
+    fix.hdop = parseNmeaFloat(fields[8]);
+    fix.updated |= GPS_POSITION_UPDATED;
+    return 1;
+}
+
+//Position is taken from GGA, which also has altitude, so RMC only gives velocity
+int parseRmcFields(char** fields, int /*number*/, GpsFix &fix) {
+    fix.time = parseNmeaTime(fields[1]);
+    if ((fields[2][0] != 'A') || !fields[7][0])
+        return 1;
+    fix.groundSpeed = KNOTS_TO_METERS_PER_SECOND * parseNmeaFloat(fields[7]);
+    //Course is left empty while the receiver stands still
+    if (fields[8][0])
+        fix.course = parseNmeaFloat(fields[8]);
+    fix.updated |= GPS_VELOCITY_UPDATED;
+    return 1;
+}
+
+int parseVtgFields(char** fields, int number, GpsFix &fix) {
+    if ((number > 9) && (fields[9][0] == 'N'))
+        return 1;
+    if (fields[7][0])
+        fix.groundSpeed = KMH_TO_METERS_PER_SECOND * parseNmeaFloat(fields[7]);
+    else if (fields[5][0])
+        fix.groundSpeed = KNOTS_TO_METERS_PER_SECOND * parseNmeaFloat(fields[5]);
+    else
+        return 1;
+    if (fields[1][0])
+        fix.course = parseNmeaFloat(fields[1]);
+    fix.updated |= GPS_VELOCITY_UPDATED;
+    return 1;
+}
+
+int parseGsaFields(char** fields, int /*number*/, GpsFix &fix) {
+    uint64_t scale;
+    fix.fixType = parseNmeaDecimal(fields[2], scale);
+    if (!fields[15][0])
+        return 1;
+    fix.pdop = parseNmeaFloat(fields[15]);
+    fix.hdop = parseNmeaFloat(fields[16]);
+    fix.vdop = parseNmeaFloat(fields[17]);
+    fix.updated |= GPS_DOP_UPDATED;
+    return 1;
+}
+
+int parseGstFields(char** fields, int /*number*/, GpsFix &fix) {
+    if (!fields[6][0] || !fields[7][0])
+        return 1;
+    float latitudeError = parseNmeaFloat(fields[6]);
+    float longitudeError = parseNmeaFloat(fields[7]);
+    fix.horizontalAccuracy = sqrt(latitudeError * latitudeError + longitudeError * longitudeError);
+    if (fields[8][0])
+        fix.verticalAccuracy = parseNmeaFloat(fields[8]);
+    fix.updated |= GPS_ACCURACY_UPDATED;
+    return 1;
+}
+
+//Talker of the sentence ("GP", "GN" and so on) is not checked, so one entry serves every constellation
+static const NmeaSentenceType nmeaSentenceTypes[] = {
+    { "GGA", 10, parseGgaFields },
+    { "RMC", 9, parseRmcFields },
+    { "VTG", 8, parseVtgFields },
+    { "GSA", 18, parseGsaFields },
+    { "GST", 9, parseGstFields }
+};
+
+void initGpsFix(GpsFix &fix) {
+    memset(&fix, 0, sizeof(GpsFix));
+}
+
+int checkNmeaChecksum(const char* sentence, uint32_t length) {
+    //Checksum is XOR of all characters between '$' and '*', written as two hex digits
+    if ((length < 4) || (sentence[0] != '$') || (sentence[length - 3] != '*'))
+        return 0;
+    uint8_t checksum = 0;
+    for (uint32_t i = 1; i < length - 3; i++)
+        checksum ^= (uint8_t)sentence[i];
+    uint8_t expected;
+    if (!hexToBytes(sentence + length - 2, 2, &expected, 1))
+        return 0;
+    return (checksum == expected);
+}
+
+int parseNmeaSentence(char* sentence, uint32_t length, GpsFix &fix) {
+    if (!checkNmeaChecksum(sentence, length))
+        return 0;
+    sentence[length - 3] = '\0';
+    if ((length < 9) || (sentence[1] == 'P'))
+        return 1;
+
+    for (const NmeaSentenceType &sentenceType : nmeaSentenceTypes) {
+        if (strncmp(sentence + 3, sentenceType.type, 3) || (sentence[6] != ','))
+            continue;
+        char* fields[NMEA_MAX_FIELDS];
+        int number = splitNmeaFields(sentence, fields, NMEA_MAX_FIELDS);
+        if (number < sentenceType.minFields)
+            return 0;
+        return sentenceType.parse(fields, number, fix);
+    }
+
+    //Sentences without anything for the fix, like GSV, are valid but skipped
+    return 1;
+}
\ No newline at end of file
@@ -0,0 +1,144 @@
+#include "../include/nmea_reader.h"
+#include "../include/ubx_parser.h"
+
+#include <string.h>
+
+#define NMEA_BUFFER_MASK (NMEA_BUFFER_SIZE - 1)
+#define UBX_SYNC_FIRST 0xB5
+#define UBX_SYNC_SECOND 0x62
+
+static_assert(!(NMEA_BUFFER_SIZE & NMEA_BUFFER_MASK), "NMEA buffer size must be a power of two");
+
+void initNmeaReader(NmeaReader &reader) {
+    reader.head = 0;
+    reader.tail = 0;
+    reader.sentences = 0;
+    reader.droppedBytes = 0;
+}
+
+uint8_t* getNmeaWriteSpace(NmeaReader &reader, uint32_t &size) {
+    //Only the part up to the end of the buffer is given, the next read continues from its start
+    uint32_t used = reader.head - reader.tail;
+    uint32_t offset = reader.head & NMEA_BUFFER_MASK;
+    size = NMEA_BUFFER_SIZE - used;
+    if (size > NMEA_BUFFER_SIZE - offset)
+        size = NMEA_BUFFER_SIZE - offset;
+    return reader.buffer + offset;
+}
+
+void commitNmeaWrite(NmeaReader &reader, uint32_t size) {
+    reader.head += size;
+}
+
+void dropNmeaBytes(NmeaReader &reader, uint32_t size) {
+    reader.tail += size;
+    reader.droppedBytes += size;
+}
+
+//Buffered bytes lie in at most two parts, each of them is searched with memchr
+int32_t findNmeaByte(NmeaReader &reader, uint32_t from, uint8_t value) {
+    uint32_t used = reader.head - reader.tail;
+    while (from < used) {
+        uint32_t offset = (reader.tail + from) & NMEA_BUFFER_MASK;
+        uint32_t size = used - from;
+        if (size > NMEA_BUFFER_SIZE - offset)
+            size = NMEA_BUFFER_SIZE - offset;
+        uint8_t* found = (uint8_t*)memchr(reader.buffer + offset, value, size);
+        if (found != NULL)
+            return from + (found - (reader.buffer + offset));
+        from += size;
+    }
+    return -1;
+}
+
+void copyNmeaBytes(NmeaReader &reader, uint32_t from, uint32_t size, char* destination) {
+    uint32_t offset = (reader.tail + from) & NMEA_BUFFER_MASK;
+    uint32_t firstSize = (size < NMEA_BUFFER_SIZE - offset) ? size : (NMEA_BUFFER_SIZE - offset);
+    memcpy(destination, reader.buffer + offset, firstSize);
+    memcpy(destination + firstSize, reader.buffer, size - firstSize);
+}
+
+int nextNmeaSentence(NmeaReader &reader, char* sentence, uint32_t &length) {
+    while (true) {
+        //Bytes before the sentence start are noise or a tail of a sentence lost in the buffer overflow
+        int32_t start = findNmeaByte(reader, 0, '$');
+        if (start == -1) {
+            dropNmeaBytes(reader, reader.head - reader.tail);
+            return 0;
+        }
+        dropNmeaBytes(reader, start);
+
+        int32_t end = findNmeaByte(reader, 1, '\n');
+        if (end == -1) {
+            //Incomplete sentence that can no longer fit is dropped, so the buffer never stalls
+            if (reader.head - reader.tail > NMEA_MAX_SENTENCE_LENGTH)
+                dropNmeaBytes(reader, 1);
+            else
+                return 0;
+            continue;
+        }
+        if ((uint32_t)end > NMEA_MAX_SENTENCE_LENGTH) {
+            dropNmeaBytes(reader, 1);
+            continue;
+        }
+
+        length = end;
+        copyNmeaBytes(reader, 0, length, sentence);
+        reader.tail += end + 1;
+        if (length && (sentence[length - 1] == '\r'))
+            length--;
+        sentence[length] = '\0';
+
+        //Sentence cut off by a new one keeps only the last start
+        char* lastStart = strrchr(sentence, '$');
+        if (lastStart != sentence) {
+            reader.droppedBytes += lastStart - sentence;
+            length -= lastStart - sentence;
+            memmove(sentence, lastStart, length + 1);
+        }
+        reader.sentences++;
+        return 1;
+    }
+}
+const uint8_t* nextUbxFrame(NmeaReader &reader, uint8_t* frameCopy, uint32_t &length) {
+    while (true) {
+        //NMEA text left from before the receiver was switched to UBX is skipped as noise
+        int32_t start = findNmeaByte(reader, 0, UBX_SYNC_FIRST);
+        if (start == -1) {
+            dropNmeaBytes(reader, reader.head - reader.tail);
+            return NULL;
+        }
+        dropNmeaBytes(reader, start);
+
+        if (reader.head - reader.tail < UBX_HEADER_SIZE)
+            return NULL;
+        uint8_t header[UBX_HEADER_SIZE];
+        copyNmeaBytes(reader, 0, UBX_HEADER_SIZE, (char*)header);
+        uint32_t payloadSize = header[4] | (header[5] << 8);
+        if ((header[1] != UBX_SYNC_SECOND) || (payloadSize > UBX_MAX_PAYLOAD_SIZE)) {
+            dropNmeaBytes(reader, 1);
+            continue;
+        }
+        length = UBX_HEADER_SIZE + payloadSize + 2;
+        if (reader.head - reader.tail < length)
+            return NULL;
+
+        const uint8_t* frame = reader.buffer + (reader.tail & NMEA_BUFFER_MASK);
+        if ((reader.tail & NMEA_BUFFER_MASK) + length > NMEA_BUFFER_SIZE) {
+            copyNmeaBytes(reader, 0, length, (char*)frameCopy);
+            frame = frameCopy;
+        }
+
+        //Sync word met inside other data gives a wrong checksum, search goes on from the next byte
+        uint8_t checksumA, checksumB;
+        computeUbxChecksum(frame + 2, length - 4, checksumA, checksumB);
+        if ((checksumA != frame[length - 2]) || (checksumB != frame[length - 1])) {
+            dropNmeaBytes(reader, 1);
+            continue;
+        }
+
+        reader.tail += length;
+        reader.sentences++;
+        return frame;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,104 @@
+#include "../include/position_history.h"
+
+#include <chrono>
+
+static_assert((POSITION_HISTORY_SIZE & (POSITION_HISTORY_SIZE - 1)) == 0, "POSITION_HISTORY_SIZE has to be a power of two");
+
+//Steady clock is the same in every entity, so other entities can ask for positions at their own time
+uint64_t getPositionTimeUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void storePosition(PositionHistory &history, uint64_t timeUs, int32_t latitude, int32_t longitude, int32_t altitude) {
+    uint64_t index = history.count.load(std::memory_order_relaxed);
+    PositionRecord &record = history.records[index & (POSITION_HISTORY_SIZE - 1)];
+    uint32_t sequence = record.sequence.load(std::memory_order_relaxed);
+
+    record.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    record.index.store(index, std::memory_order_relaxed);
+    record.timeUs.store(timeUs, std::memory_order_relaxed);
+    record.latitude.store(latitude, std::memory_order_relaxed);
+    record.longitude.store(longitude, std::memory_order_relaxed);
+    record.altitude.store(altitude, std::memory_order_relaxed);
+    record.sequence.store(sequence + 2, std::memory_order_release);
+
+    history.count.store(index + 1, std::memory_order_release);
+}
+
+//Fails when the position is already overwritten by a newer one
+int readPosition(const PositionHistory &history, uint64_t index, PositionSample &sample) {
+    const PositionRecord &record = history.records[index & (POSITION_HISTORY_SIZE - 1)];
+    uint32_t sequence;
+    uint64_t recordIndex;
+    do {
+        sequence = record.sequence.load(std::memory_order_acquire);
+        recordIndex = record.index.load(std::memory_order_relaxed);
+        sample.timeUs = record.timeUs.load(std::memory_order_relaxed);
+        sample.latitude = record.latitude.load(std::memory_order_relaxed);
+        sample.longitude = record.longitude.load(std::memory_order_relaxed);
+        sample.altitude = record.altitude.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((sequence & 1) || (sequence != record.sequence.load(std::memory_order_relaxed)));
+    return (recordIndex == index);
+}
+
+int32_t interpolate(int32_t first, int32_t second, uint64_t offset, uint64_t interval) {
+    return first + (int32_t)(((int64_t)second - first) * (int64_t)offset / (int64_t)interval);
+}
+
+int getLastPosition(const PositionHistory &history, PositionSample &sample) {
+    uint64_t count = history.count.load(std::memory_order_acquire);
+    return (count && readPosition(history, count - 1, sample));
+}
+
+int getPositionAt(const PositionHistory &history, uint64_t timeUs, PositionSample &sample) {
+    uint64_t maxGapUs = (uint64_t)POSITION_HISTORY_MAX_GAP_MS * 1000;
+    uint64_t count = history.count.load(std::memory_order_acquire);
+    if (!count)
+        return 0;
+
+    //Position is held after the last sample for as long as it would be interpolated before it
+    PositionSample last, first;
+    if (!readPosition(history, count - 1, last))
+        return 0;
+    if (timeUs >= last.timeUs) {
+        if (timeUs - last.timeUs > maxGapUs)
+            return 0;
+        sample = last;
+        sample.timeUs = timeUs;
+        return 1;
+    }
+
+    //Oldest record is skipped, it is the next to be overwritten
+    uint64_t low = (count > POSITION_HISTORY_SIZE) ? (count - POSITION_HISTORY_SIZE + 1) : 0;
+    uint64_t high = count - 1;
+    if (!readPosition(history, low, first) || (timeUs < first.timeUs))
+        return 0;
+
+    //Timestamps only grow, so the samples around the time are found by bisection
+    PositionSample middle;
+    while (high - low > 1) {
+        uint64_t index = low + (high - low) / 2;
+        if (!readPosition(history, index, middle))
+            return 0;
+        if (middle.timeUs <= timeUs) {
+            low = index;
+            first = middle;
+        }
+        else {
+            high = index;
+            last = middle;
+        }
+    }
+
+    if ((last.timeUs <= first.timeUs) || (last.timeUs - first.timeUs > maxGapUs))
+        return 0;
+    uint64_t offset = timeUs - first.timeUs;
+    uint64_t interval = last.timeUs - first.timeUs;
+    sample.timeUs = timeUs;
+    sample.latitude = interpolate(first.latitude, last.latitude, offset, interval);
+    sample.longitude = interpolate(first.longitude, last.longitude, offset, interval);
+    sample.altitude = interpolate(first.altitude, last.altitude, offset, interval);
+    return 1;
+}
\ No newline at end of file
@@ -0,0 +1,78 @@
+#include "../include/sim_sensor_reader.h"
+
+#include <string.h>
+
+static_assert(SIM_SENSOR_BUFFER_SIZE >= 2 * sizeof(SimSensorDataMessage), "Simulator sensor buffer has to hold an incomplete message and a read");
+
+void initSimSensorReader(SimSensorReader &reader) {
+    reader.start = 0;
+    reader.size = 0;
+    reader.synchronized = true;
+    reader.messages = 0;
+    reader.resyncs = 0;
+    reader.droppedBytes = 0;
+}
+
+uint8_t* getSimSensorWriteSpace(SimSensorReader &reader, uint32_t &size) {
+    //Only an incomplete message is left after parsing, so the move is a few bytes long
+    if (reader.start) {
+        memmove(reader.buffer, reader.buffer + reader.start, reader.size - reader.start);
+        reader.size -= reader.start;
+        reader.start = 0;
+    }
+    size = SIM_SENSOR_BUFFER_SIZE - reader.size;
+    return reader.buffer + reader.size;
+}
+
+void commitSimSensorWrite(SimSensorReader &reader, uint32_t size) {
+    reader.size += size;
+}
+
+//Header is searched with memchr on its first byte, which is vectorized in libc
+bool hasSimSensorHead(const uint8_t* data, uint32_t size) {
+    const uint8_t* end = data + size;
+    while (end - data >= SIM_SENSOR_DATA_MESSAGE_HEAD_SIZE) {
+        const uint8_t* found = (const uint8_t*)memchr(data, SimSensorDataMessageHead[0], end - data - SIM_SENSOR_DATA_MESSAGE_HEAD_SIZE + 1);
+        if (found == NULL)
+            return false;
+        if (!memcmp(found, SimSensorDataMessageHead, SIM_SENSOR_DATA_MESSAGE_HEAD_SIZE))
+            return true;
+        data = found + 1;
+    }
+    return false;
+}
+
+int nextSimSensorMessage(SimSensorReader &reader, SimSensorDataMessage &message) {
+    while (reader.size - reader.start >= SIM_SENSOR_DATA_MESSAGE_HEAD_SIZE) {
+        uint8_t* data = reader.buffer + reader.start;
+        uint32_t used = reader.size - reader.start;
+
+        //Message has no checksum, one that lost bytes holds the header of the next message.
+        //It is seen when the next message is already received, waiting for it would delay every message
+        uint32_t checked = used;
+        if (checked > sizeof(SimSensorDataMessage) + SIM_SENSOR_DATA_MESSAGE_HEAD_SIZE - 1)
+            checked = sizeof(SimSensorDataMessage) + SIM_SENSOR_DATA_MESSAGE_HEAD_SIZE - 1;
+
+        if (memcmp(data, SimSensorDataMessageHead, SIM_SENSOR_DATA_MESSAGE_HEAD_SIZE) || hasSimSensorHead(data + 1, checked - 1)) {
+            //Stream is scanned forward to the next possible header start, one lost byte costs one message
+            if (reader.synchronized) {
+                reader.synchronized = false;
+                reader.resyncs++;
+            }
+            uint8_t* found = (uint8_t*)memchr(data + 1, SimSensorDataMessageHead[0], used - 1);
+            uint32_t skipped = (found != NULL) ? (found - data) : used;
+            reader.start += skipped;
+            reader.droppedBytes += skipped;
+            continue;
+        }
+
+        if (used < sizeof(SimSensorDataMessage))
+            return 0;
+        memcpy(&message, data, sizeof(SimSensorDataMessage));
+        reader.start += sizeof(SimSensorDataMessage);
+        reader.synchronized = true;
+        reader.messages++;
+        return 1;
+    }
+    return 0;
+}
\ No newline at end of file
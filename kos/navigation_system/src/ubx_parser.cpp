@@ -0,0 +1,103 @@
+#include "../include/ubx_parser.h"
+#include "../include/nmea_reader.h"
+
+#include <string.h>
+#include <math.h>
+
+#define UBX_CONFIG_RAM_LAYER 0x01
+#define UBX_NAV_PVT_FIX_OK 0x01
+
+#define CFG_UART1OUTPROT_UBX 0x10740001
+#define CFG_UART1OUTPROT_NMEA 0x10740002
+#define CFG_RATE_MEAS 0x30210001
+#define CFG_RATE_NAV 0x30210002
+#define CFG_MSGOUT_UBX_NAV_PVT_UART1 0x20910007
+
+//UBX is little-endian and fields are not aligned, so they are assembled from bytes
+uint16_t getUbxU2(const uint8_t* data) {
+    return data[0] | (data[1] << 8);
+}
+
+uint32_t getUbxU4(const uint8_t* data) {
+    return data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+int32_t getUbxI4(const uint8_t* data) {
+    return (int32_t)getUbxU4(data);
+}
+
+uint32_t putUbxValue(uint8_t* data, uint32_t key, uint32_t value, uint32_t size) {
+    for (int i = 0; i < 4; i++)
+        data[i] = (key >> (8 * i)) & 0xFF;
+    for (uint32_t i = 0; i < size; i++)
+        data[4 + i] = (value >> (8 * i)) & 0xFF;
+    return 4 + size;
+}
+
+void computeUbxChecksum(const uint8_t* data, uint32_t size, uint8_t &checksumA, uint8_t &checksumB) {
+    checksumA = 0;
+    checksumB = 0;
+    for (uint32_t i = 0; i < size; i++) {
+        checksumA += data[i];
+        checksumB += checksumA;
+    }
+}
+
+uint32_t makeUbxFrame(uint8_t messageClass, uint8_t id, const uint8_t* payload, uint16_t payloadSize, uint8_t* frame) {
+    frame[0] = 0xB5;
+    frame[1] = 0x62;
+    frame[2] = messageClass;
+    frame[3] = id;
+    frame[4] = payloadSize & 0xFF;
+    frame[5] = payloadSize >> 8;
+    memcpy(frame + UBX_HEADER_SIZE, payload, payloadSize);
+    computeUbxChecksum(frame + 2, payloadSize + 4, frame[UBX_HEADER_SIZE + payloadSize], frame[UBX_HEADER_SIZE + payloadSize + 1]);
+    return UBX_HEADER_SIZE + payloadSize + 2;
+}
+
+uint32_t makeUbxNavPvtConfig(uint16_t measurementPeriodMs, uint8_t* frame) {
+    //Configuration is sent on every start, so it is kept in RAM only
+    uint8_t payload[64] = { 0x00, UBX_CONFIG_RAM_LAYER, 0x00, 0x00 };
+    uint32_t size = 4;
+    size += putUbxValue(payload + size, CFG_UART1OUTPROT_UBX, 1, 1);
+    size += putUbxValue(payload + size, CFG_UART1OUTPROT_NMEA, 0, 1);
+    size += putUbxValue(payload + size, CFG_RATE_MEAS, measurementPeriodMs, 2);
+    size += putUbxValue(payload + size, CFG_RATE_NAV, 1, 2);
+    size += putUbxValue(payload + size, CFG_MSGOUT_UBX_NAV_PVT_UART1, 1, 1);
+    return makeUbxFrame(UBX_CLASS_CFG, UBX_CFG_VALSET, payload, size, frame);
+}
+
+//Fields of NAV-PVT are read straight from the frame by their offsets in the payload
+int parseUbxNavPvt(const uint8_t* payload, GpsFix &fix) {
+    fix.timeOfWeek = getUbxU4(payload);
+    int32_t time = 3600000 * payload[8] + 60000 * payload[9] + 1000 * payload[10] + getUbxI4(payload + 16) / 1000000;
+    fix.time = (time < 0) ? 0 : time;
+    fix.fixType = payload[20];
+    fix.sats = payload[23];
+    //Dead reckoning only (1) and time only (5) fixes have no usable position
+    fix.valid = (payload[21] & UBX_NAV_PVT_FIX_OK) && (fix.fixType >= 2) && (fix.fixType <= 4);
+    if (!fix.valid)
+        return 1;
+
+    fix.longitude = getUbxI4(payload + 24);
+    fix.latitude = getUbxI4(payload + 28);
+    fix.altitude = getUbxI4(payload + 36) / 10;
+    fix.horizontalAccuracy = getUbxU4(payload + 40) / 1000.0f;
+    fix.verticalAccuracy = getUbxU4(payload + 44) / 1000.0f;
+    fix.groundSpeed = getUbxI4(payload + 60) / 1000.0f;
+    fix.course = getUbxI4(payload + 64) / 100000.0f;
+    //NAV-PVT has only position DOP, it is reported in place of horizontal one and is never smaller
+    fix.pdop = getUbxU2(payload + 76) / 100.0f;
+    fix.hdop = fix.pdop;
+    fix.updated |= GPS_POSITION_UPDATED | GPS_VELOCITY_UPDATED | GPS_ACCURACY_UPDATED | GPS_DOP_UPDATED;
+    return 1;
+}
+
+int parseUbxFrame(const uint8_t* frame, uint32_t length, GpsFix &fix) {
+    //Acknowledgements and other messages the receiver sends are valid but skipped
+    if ((frame[2] != UBX_CLASS_NAV) || (frame[3] != UBX_NAV_PVT))
+        return 1;
+    if (length != UBX_HEADER_SIZE + UBX_NAV_PVT_PAYLOAD_SIZE + 2)
+        return 0;
+    return parseUbxNavPvt(frame + UBX_HEADER_SIZE, fix);
+}
\ No newline at end of file
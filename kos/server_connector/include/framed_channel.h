@@ -0,0 +1,20 @@
+#pragma once
+
+#include <stdint.h>
+#include <chrono>
+
+//Frame layout: payload length (2 bytes), frame type (1 byte), flags (1 byte), sequence number (2 bytes).
+//All fields are in network byte order, payload is not null-terminated and is shorter than FRAME_MAX_PAYLOAD
+#define FRAME_HEADER_SIZE 6
+#define FRAME_MAX_PAYLOAD 1024
+//Request signature is cut from the query and follows it after a zero byte as raw bytes instead of '&sig=0x' and hex digits
+#define FRAME_FLAG_BINARY_SIGNATURE 0x01
+
+enum FrameType {
+    FRAME_TELEMETRY = 1,
+    FRAME_COMMAND = 2,
+    FRAME_RESPONSE = 3,
+    FRAME_PUSH = 4
+};
+
+int sendFramedRequest(char* query, char* response, std::chrono::steady_clock::time_point deadline);
\ No newline at end of file
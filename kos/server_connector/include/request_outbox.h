@@ -0,0 +1,10 @@
+#pragma once
+
+#define OUTBOX_CAPACITY 64
+#define OUTBOX_QUERY_LENGTH 1024
+
+int initOutbox();
+
+int storeRequest(char* query);
+
+void flushOutbox();
\ No newline at end of file
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdint.h>
+
+#define MAX_SERVER_CONNECTIONS 2
+
+//Result of waiting for a connection: superseded telemetry is dropped by design, it is not a failure
+#define CONNECTION_EXPIRED 0
+#define CONNECTION_ACQUIRED 1
+#define CONNECTION_SUPERSEDED 2
+
+enum RequestClass {
+    SAFETY_REQUEST,
+    CONTROL_REQUEST,
+    TELEMETRY_REQUEST,
+    BULK_REQUEST,
+    REQUEST_CLASS_NUMBER
+};
+
+RequestClass classifyRequest(char* query);
+int isDeferrableRequest(char* query);
+int isLongPollRequest(char* query);
+int isIdempotentRequest(char* query);
+uint32_t getRequestDeadline(char* query);
+const char* getRequestClassName(RequestClass requestClass);
+
+int acquireConnection(RequestClass requestClass, int longPoll);
+void releaseConnection(int longPoll);
+
+void recordRequestLatency(char* query, int status, uint64_t latencyUs);
+void printSchedulerStats();
\ No newline at end of file
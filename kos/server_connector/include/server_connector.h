@@ -1,5 +1,12 @@
 #pragma once
 
+#include <stdint.h>
+
+#define REQUEST_FAILED 0
+#define REQUEST_SUCCEEDED 1
+#define REQUEST_TIMED_OUT 2
+#define REQUEST_SUPERSEDED 3
+
 int initServerConnector();
 
-int sendRequest(char* query, char* response);
\ No newline at end of file
+int sendRequest(char* query, char* response, uint32_t deadlineMs);
\ No newline at end of file
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <stdint.h>
+
+#define MAX_SERVER_ENDPOINTS 4
+
+int initServerEndpoints();
+
+uint32_t getServerEndpointOrder(uint32_t* order);
+const char* getServerEndpointIp(uint32_t index);
+uint16_t getServerEndpointPort(uint32_t index);
+
+void reportServerEndpoint(uint32_t index, int status, uint64_t latencyUs);
\ No newline at end of file
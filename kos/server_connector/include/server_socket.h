@@ -0,0 +1,8 @@
+#pragma once
+
+#include <stdint.h>
+#include <chrono>
+
+int waitForSocket(int socketDesc, short events, std::chrono::steady_clock::time_point deadline);
+int connectToServer(int &socketDesc, const char* ip, uint16_t port, std::chrono::steady_clock::time_point deadline);
+int sendToSocket(int socketDesc, const char* data, int length, std::chrono::steady_clock::time_point deadline);
\ No newline at end of file
@@ -0,0 +1,264 @@
+#include "../include/framed_channel.h"
+#include "../include/request_scheduler.h"
+#include "../include/server_connector.h"
+#include "../include/server_endpoints.h"
+#include "../include/server_socket.h"
+#include "../../shared/include/hex_codec.h"
+
+#include <kos_net.h>
+
+#include <errno.h>
+#include <poll.h>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#define MAX_PENDING_FRAMES 8
+#define SIGNATURE_PARAMETER "&sig=0x"
+
+struct PendingFrame {
+    bool used;
+    bool done;
+    uint16_t sequence;
+    uint32_t generation;
+    char response[FRAME_MAX_PAYLOAD + 1];
+};
+
+std::mutex channelMutex;
+std::mutex channelWriteMutex;
+std::condition_variable channelCondition;
+int channelSocket = -1;
+bool channelConnecting = false;
+uint32_t channelEndpoint = 0;
+uint32_t channelGeneration = 0;
+uint16_t nextSequence = 0;
+PendingFrame pendingFrames[MAX_PENDING_FRAMES];
+
+int receiveFromChannel(int socketDesc, uint8_t* buffer, uint32_t length) {
+    uint32_t receivedBytes = 0;
+    while (receivedBytes < length) {
+        struct pollfd descriptor = { socketDesc, POLLIN, 0 };
+        if ((poll(&descriptor, 1, -1) < 0) && (errno != EINTR))
+            return 0;
+        ssize_t rc = recv(socketDesc, buffer + receivedBytes, length - receivedBytes, 0);
+        if (rc > 0)
+            receivedBytes += rc;
+        else if (!rc || ((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR)))
+            return 0;
+    }
+    return 1;
+}
+
+void readFrames(int socketDesc, uint32_t generation) {
+    uint8_t header[FRAME_HEADER_SIZE];
+    char payload[FRAME_MAX_PAYLOAD + 1];
+
+    while (receiveFromChannel(socketDesc, header, FRAME_HEADER_SIZE)) {
+        uint16_t length = (header[0] << 8) | header[1];
+        uint8_t type = header[2];
+        uint16_t sequence = (header[4] << 8) | header[5];
+        //Answer is copied with its terminating null into a response of FRAME_MAX_PAYLOAD bytes, so it is shorter than that
+        if ((length >= FRAME_MAX_PAYLOAD) || !receiveFromChannel(socketDesc, (uint8_t*)payload, length)) {
+            fprintf(stderr, "[%s] Warning: Failed to receive a frame from the server\n", ENTITY_NAME);
+            break;
+        }
+        payload[length] = '\0';
+
+        if (type == FRAME_PUSH)
+            fprintf(stderr, "[%s] Info: Received a state push from the server: %s\n", ENTITY_NAME, payload);
+        else if (type == FRAME_RESPONSE) {
+            std::lock_guard<std::mutex> lock(channelMutex);
+            for (PendingFrame &frame : pendingFrames)
+                if (frame.used && !frame.done && (frame.sequence == sequence) && (frame.generation == generation)) {
+                    strcpy(frame.response, payload);
+                    frame.done = true;
+                    channelCondition.notify_all();
+                    break;
+                }
+        }
+        else
+            fprintf(stderr, "[%s] Warning: Received a frame of unknown type %d from the server\n", ENTITY_NAME, type);
+    }
+
+    fprintf(stderr, "[%s] Warning: Channel to the server is closed\n", ENTITY_NAME);
+    channelMutex.lock();
+    channelSocket = -1;
+    channelGeneration++;
+    channelCondition.notify_all();
+    channelMutex.unlock();
+
+    //Senders check the generation under the write lock, so the descriptor is not reused while a stale one writes to it
+    channelWriteMutex.lock();
+    close(socketDesc);
+    channelWriteMutex.unlock();
+}
+
+//Called without the channel lock, so requests to an open channel are not held while another one connects
+int connectChannel(int &socketDesc, uint32_t &endpoint, std::chrono::steady_clock::time_point deadline) {
+    uint32_t order[MAX_SERVER_ENDPOINTS];
+    uint32_t endpointNumber = getServerEndpointOrder(order);
+
+    int status = REQUEST_FAILED;
+    for (uint32_t i = 0; i < endpointNumber; i++) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        if (start >= deadline)
+            return REQUEST_TIMED_OUT;
+        //Channel is opened on the gateway port of the same host as the HTTP endpoint
+        status = connectToServer(socketDesc, getServerEndpointIp(order[i]), FRAMED_CHANNEL_PORT,
+            start + (deadline - start) / (endpointNumber - i));
+        if (status == REQUEST_SUCCEEDED) {
+            endpoint = order[i];
+            return status;
+        }
+        reportServerEndpoint(order[i], status,
+            std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    return status;
+}
+
+//Hex signature takes twice its size, so it is sent as bytes when it is the last query parameter
+uint32_t encodeFramePayload(char* query, char* payload, uint8_t &flags) {
+    uint32_t length = strlen(query);
+    flags = 0;
+    char* signature = strstr(query, SIGNATURE_PARAMETER);
+    if (signature != NULL) {
+        uint32_t queryLength = signature - query;
+        signature += strlen(SIGNATURE_PARAMETER);
+        uint32_t hexLength = length - (signature - query);
+        //Odd number of digits would get a leading zero on the way back, so such a signature is sent as is
+        if (hexLength && !(hexLength % 2) && hexToBytes(signature, hexLength, (uint8_t*)payload + queryLength + 1, hexLength / 2)) {
+            memcpy(payload, query, queryLength);
+            payload[queryLength] = '\0';
+            flags = FRAME_FLAG_BINARY_SIGNATURE;
+            return queryLength + 1 + hexLength / 2;
+        }
+    }
+    memcpy(payload, query, length);
+    return length;
+}
+
+int exchangeFrames(char* query, char* response, uint32_t &endpoint, std::chrono::steady_clock::time_point deadline) {
+    std::unique_lock<std::mutex> lock(channelMutex);
+    //Only one request opens the channel, the others wait for it to be opened
+    while ((channelSocket < 0) && channelConnecting)
+        if (channelCondition.wait_until(lock, deadline) == std::cv_status::timeout)
+            return REQUEST_TIMED_OUT;
+    if (channelSocket < 0) {
+        channelConnecting = true;
+        lock.unlock();
+        int socketDesc = -1;
+        uint32_t connectedEndpoint = 0;
+        int status = connectChannel(socketDesc, connectedEndpoint, deadline);
+        lock.lock();
+        channelConnecting = false;
+        if (status == REQUEST_SUCCEEDED) {
+            channelSocket = socketDesc;
+            channelEndpoint = connectedEndpoint;
+            std::thread(readFrames, socketDesc, channelGeneration).detach();
+        }
+        channelCondition.notify_all();
+        if (status != REQUEST_SUCCEEDED)
+            return status;
+    }
+
+    PendingFrame* frame = NULL;
+    for (PendingFrame &pending : pendingFrames)
+        if (!pending.used) {
+            frame = &pending;
+            break;
+        }
+    if (frame == NULL) {
+        fprintf(stderr, "[%s] Warning: Too many requests are pending on the channel\n", ENTITY_NAME);
+        return REQUEST_FAILED;
+    }
+    frame->used = true;
+    frame->done = false;
+    frame->sequence = nextSequence++;
+    frame->generation = channelGeneration;
+    int socketDesc = channelSocket;
+    endpoint = channelEndpoint;
+    lock.unlock();
+
+    char message[FRAME_HEADER_SIZE + FRAME_MAX_PAYLOAD];
+    uint8_t flags = 0;
+    uint32_t length = encodeFramePayload(query, message + FRAME_HEADER_SIZE, flags);
+    message[0] = (char)(length >> 8);
+    message[1] = (char)(length & 0xFF);
+    message[2] = (classifyRequest(query) == TELEMETRY_REQUEST) ? FRAME_TELEMETRY : FRAME_COMMAND;
+    message[3] = flags;
+    message[4] = (char)(frame->sequence >> 8);
+    message[5] = (char)(frame->sequence & 0xFF);
+
+    //Socket is closed only under the write lock after the generation has changed, so it is still open if the generation is the same
+    int status = REQUEST_FAILED;
+    channelWriteMutex.lock();
+    lock.lock();
+    bool current = (frame->generation == channelGeneration);
+    lock.unlock();
+    if (current)
+        status = sendToSocket(socketDesc, message, FRAME_HEADER_SIZE + length, deadline);
+    channelWriteMutex.unlock();
+
+    lock.lock();
+    if (status != REQUEST_SUCCEEDED) {
+        //A partially sent frame breaks the stream, so the channel is reopened on the next request
+        fprintf(stderr, "[%s] Warning: Failed to send a frame%s\n", ENTITY_NAME, (status == REQUEST_TIMED_OUT) ? ": timed out" : "");
+        if (frame->generation == channelGeneration)
+            shutdown(socketDesc, SHUT_RDWR);
+        frame->used = false;
+        return status;
+    }
+
+    while (!frame->done && (frame->generation == channelGeneration))
+        if (channelCondition.wait_until(lock, deadline) == std::cv_status::timeout)
+            break;
+
+    if (frame->done) {
+        char* msg = strstr(frame->response, "$");
+        if (msg == NULL) {
+            fprintf(stderr, "[%s] Warning: Failed to parse response content\n", ENTITY_NAME);
+            status = REQUEST_FAILED;
+        }
+        else
+            strcpy(response, msg);
+    }
+    else if (frame->generation != channelGeneration)
+        status = REQUEST_FAILED;
+    else {
+        fprintf(stderr, "[%s] Warning: Failed to receive a response: timed out\n", ENTITY_NAME);
+        status = REQUEST_TIMED_OUT;
+    }
+    frame->used = false;
+
+    return status;
+}
+
+int sendFramedRequest(char* query, char* response, std::chrono::steady_clock::time_point deadline) {
+    //Encoded payload is never longer than the query
+    if (strlen(query) >= FRAME_MAX_PAYLOAD) {
+        fprintf(stderr, "[%s] Warning: Request is too long\n", ENTITY_NAME);
+        return REQUEST_FAILED;
+    }
+
+    uint32_t order[MAX_SERVER_ENDPOINTS];
+    uint32_t endpointNumber = getServerEndpointOrder(order);
+    int status = REQUEST_FAILED;
+    for (uint32_t i = 0; i < endpointNumber; i++) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        uint32_t endpoint = MAX_SERVER_ENDPOINTS;
+        status = exchangeFrames(query, response, endpoint, deadline);
+        if (endpoint < MAX_SERVER_ENDPOINTS)
+            reportServerEndpoint(endpoint, status,
+                std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+
+        //Request is repeated on another endpoint only if the channel was lost while it was pending
+        //and the server state is not changed by the request received twice
+        std::lock_guard<std::mutex> lock(channelMutex);
+        if ((status != REQUEST_FAILED) || (endpoint == MAX_SERVER_ENDPOINTS) || (channelSocket >= 0) || !isIdempotentRequest(query)
+            || (std::chrono::steady_clock::now() >= deadline))
+            break;
+    }
+
+    return status;
+}
\ No newline at end of file
@@ -1,26 +1,22 @@
 #include "../include/server_connector.h"
 #include "../include/server_connector_interface.h"
+#include "../include/request_outbox.h"
 #include "../../shared/include/initialization_interface.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <thread>
 
 #define NK_USE_UNQUALIFIED_NAMES
 #include <drone_controller/ServerConnector.edl.h>
 
-int main(void) {
-    if (!initServerConnector())
-        return EXIT_FAILURE;
+#define SERVER_CONNECTOR_WORKERS 4
 
-    fprintf(stderr, "[%s] Info: Initialization is finished\n", ENTITY_NAME);
-
-    NkKosTransport transport;
-    initReceiverInterface("server_connector_connection", transport);
-
-    ServerConnector_entity entity;
-    ServerConnector_entity_init(&entity, CreateInitializationImpl(), CreateServerConnectorInterfaceImpl());
+std::thread workerThreads[SERVER_CONNECTOR_WORKERS - 1];
+std::thread outboxThread;
 
+void serveRequests(NkKosTransport* transport, ServerConnector_entity* entity) {
     ServerConnector_entity_req req;
     ServerConnector_entity_res res;
     char reqBuffer[ServerConnector_entity_req_arena_size];
@@ -32,14 +28,36 @@ int main(void) {
         nk_req_reset(&req);
         nk_arena_reset(&reqArena);
         nk_arena_reset(&resArena);
-        if (nk_transport_recv(&transport.base, &req.base_, &reqArena) == NK_EOK) {
-            ServerConnector_entity_dispatch(&entity, &req.base_, &reqArena, &res.base_, &resArena);
-            if (nk_transport_reply(&transport.base, &res.base_, &resArena) != NK_EOK)
+        if (nk_transport_recv(&transport->base, &req.base_, &reqArena) == NK_EOK) {
+            ServerConnector_entity_dispatch(entity, &req.base_, &reqArena, &res.base_, &resArena);
+            if (nk_transport_reply(&transport->base, &res.base_, &resArena) != NK_EOK)
                 fprintf(stderr, "[%s] Warning: Failed to send a reply to IPC-message\n", ENTITY_NAME);
         }
         else
             fprintf(stderr, "[%s] Warning: Failed to receive IPC-message\n", ENTITY_NAME);
     };
+}
+
+int main(void) {
+    if (!initServerConnector())
+        return EXIT_FAILURE;
+
+    if (!initOutbox())
+        return EXIT_FAILURE;
+    outboxThread = std::thread(flushOutbox);
+
+    fprintf(stderr, "[%s] Info: Initialization is finished\n", ENTITY_NAME);
+
+    NkKosTransport transport;
+    initReceiverInterface("server_connector_connection", transport);
+
+    ServerConnector_entity entity;
+    ServerConnector_entity_init(&entity, CreateInitializationImpl(), CreateServerConnectorInterfaceImpl());
+
+    //Requests from different entities are served in parallel and ordered by the request scheduler
+    for (int i = 0; i < SERVER_CONNECTOR_WORKERS - 1; i++)
+        workerThreads[i] = std::thread(serveRequests, &transport, &entity);
+    serveRequests(&transport, &entity);
 
     return EXIT_SUCCESS;
 }
\ No newline at end of file
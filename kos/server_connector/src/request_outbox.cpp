@@ -0,0 +1,230 @@
+#include "../include/request_outbox.h"
+#include "../include/request_scheduler.h"
+#include "../include/server_connector.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <mutex>
+
+#define OUTBOX_FLUSH_PERIOD_US 200000
+#define OUTBOX_RETRY_PERIOD_US 1000000
+#define OUTBOX_SPILL_CAPACITY 4096
+//Delivered spilled query is overwritten with the mark in place, so it is not sent again after restart
+#define OUTBOX_DELIVERED_MARK '#'
+#define SIGNATURE_FAIL_RESPONSE "$Signature verification fail"
+#define TELEMETRY_QUERY "/api/telemetry?"
+#define TELEMETRY_LOG_QUERY "/api/telemetry_log?"
+
+std::mutex outboxMutex;
+
+char outboxQueries[OUTBOX_CAPACITY][OUTBOX_QUERY_LENGTH];
+uint32_t outboxHead = 0;
+uint32_t outboxSize = 0;
+uint64_t outboxHeadId = 0;
+uint32_t outboxDropped = 0;
+uint32_t outboxRejected = 0;
+
+#ifdef OUTBOX_SPILL_PATH
+//Spilling is off by default: Server Connector is network-facing and is given no persistent storage in the images
+//Spilled queries are always older than the ones in memory, so they are flushed first
+uint32_t spillSize = 0;
+off_t spillReadOffset = 0;
+
+int readSpilledQuery(char* query, uint32_t &length) {
+    int file = open(OUTBOX_SPILL_PATH, O_RDONLY);
+    if (file == -1)
+        return 0;
+    if (lseek(file, spillReadOffset, SEEK_SET) != spillReadOffset) {
+        close(file);
+        return 0;
+    }
+    ssize_t readBytes = read(file, query, OUTBOX_QUERY_LENGTH);
+    close(file);
+    if (readBytes <= 0)
+        return 0;
+
+    char* end = (char*)memchr(query, '\n', readBytes);
+    if (end == NULL)
+        return 0;
+    *end = '\0';
+    length = end - query + 1;
+
+    return 1;
+}
+
+int spillQuery(char* query) {
+    if (spillSize >= OUTBOX_SPILL_CAPACITY)
+        return 0;
+    int file = open(OUTBOX_SPILL_PATH, O_WRONLY | O_CREAT | O_APPEND, 0600);
+    if (file == -1) {
+        fprintf(stderr, "[%s] Warning: Failed to open outbox spill file\n", ENTITY_NAME);
+        return 0;
+    }
+    char line[OUTBOX_QUERY_LENGTH + 1];
+    uint32_t len = snprintf(line, sizeof(line), "%s\n", query);
+    int written = (write(file, line, len) == len);
+    close(file);
+    if (written)
+        spillSize++;
+    return written;
+}
+
+void markSpilledQuery() {
+    char mark = OUTBOX_DELIVERED_MARK;
+    int file = open(OUTBOX_SPILL_PATH, O_WRONLY);
+    if ((file == -1) || (pwrite(file, &mark, 1, spillReadOffset) != 1))
+        fprintf(stderr, "[%s] Warning: Failed to mark a delivered request in outbox spill file\n", ENTITY_NAME);
+    if (file != -1)
+        close(file);
+}
+#endif
+
+int initOutbox() {
+#ifdef OUTBOX_SPILL_PATH
+    //Queries that were not delivered before restart are restored from the spill file
+    int file = open(OUTBOX_SPILL_PATH, O_RDONLY);
+    if (file == -1)
+        return 1;
+    //Queries are delivered in order, so reading continues after the last marked one
+    char buffer[OUTBOX_QUERY_LENGTH];
+    char lineHead = 0;
+    bool lineStart = true;
+    off_t position = 0;
+    ssize_t readBytes;
+    while ((readBytes = read(file, buffer, sizeof(buffer))) > 0) {
+        for (ssize_t i = 0; i < readBytes; i++, position++) {
+            if (lineStart) {
+                lineHead = buffer[i];
+                lineStart = false;
+            }
+            if (buffer[i] != '\n')
+                continue;
+            if (lineHead != OUTBOX_DELIVERED_MARK)
+                spillSize++;
+            else if (!spillSize)
+                spillReadOffset = position + 1;
+            lineStart = true;
+        }
+    }
+    close(file);
+    if (!spillSize) {
+        unlink(OUTBOX_SPILL_PATH);
+        spillReadOffset = 0;
+    }
+    else
+        fprintf(stderr, "[%s] Info: %u undelivered requests are restored from outbox\n", ENTITY_NAME, spillSize);
+#endif
+    return 1;
+}
+
+int storeRequest(char* query) {
+    //Stored telemetry is stale by the time it is flushed, so it fills the track log on the server
+    //and does not move the drone back to where it was
+    char logQuery[OUTBOX_QUERY_LENGTH];
+    if (!strncmp(query, TELEMETRY_QUERY, strlen(TELEMETRY_QUERY))) {
+        if (snprintf(logQuery, OUTBOX_QUERY_LENGTH, "%s%s", TELEMETRY_LOG_QUERY, query + strlen(TELEMETRY_QUERY)) >= OUTBOX_QUERY_LENGTH)
+            return 0;
+        query = logQuery;
+    }
+    if (strlen(query) >= OUTBOX_QUERY_LENGTH)
+        return 0;
+
+    std::lock_guard<std::mutex> lock(outboxMutex);
+    if (outboxSize == OUTBOX_CAPACITY) {
+        int spilled = 0;
+#ifdef OUTBOX_SPILL_PATH
+        spilled = spillQuery(outboxQueries[outboxHead]);
+#endif
+        if (!spilled) {
+            outboxDropped++;
+            fprintf(stderr, "[%s] Warning: Outbox is full, %u requests were dropped\n", ENTITY_NAME, outboxDropped);
+        }
+        outboxHead = (outboxHead + 1) % OUTBOX_CAPACITY;
+        outboxHeadId++;
+        outboxSize--;
+    }
+    strcpy(outboxQueries[(outboxHead + outboxSize) % OUTBOX_CAPACITY], query);
+    outboxSize++;
+
+    return 1;
+}
+
+int peekRequest(char* query, uint64_t &id, uint32_t &spillLength) {
+    std::lock_guard<std::mutex> lock(outboxMutex);
+    spillLength = 0;
+#ifdef OUTBOX_SPILL_PATH
+    if (spillSize) {
+        if (readSpilledQuery(query, spillLength))
+            return 1;
+        fprintf(stderr, "[%s] Warning: Outbox spill file is corrupted and is discarded\n", ENTITY_NAME);
+        unlink(OUTBOX_SPILL_PATH);
+        spillSize = 0;
+        spillReadOffset = 0;
+    }
+#endif
+    if (!outboxSize)
+        return 0;
+    strcpy(query, outboxQueries[outboxHead]);
+    id = outboxHeadId;
+    return 1;
+}
+
+void popRequest(uint64_t id, uint32_t spillLength) {
+    std::lock_guard<std::mutex> lock(outboxMutex);
+#ifdef OUTBOX_SPILL_PATH
+    if (spillLength) {
+        markSpilledQuery();
+        spillReadOffset += spillLength;
+        spillSize--;
+        if (!spillSize) {
+            unlink(OUTBOX_SPILL_PATH);
+            spillReadOffset = 0;
+        }
+        return;
+    }
+#endif
+    //The query could have been already evicted by a newer one while it was being sent
+    if (!outboxSize || (id != outboxHeadId))
+        return;
+    outboxHead = (outboxHead + 1) % OUTBOX_CAPACITY;
+    outboxHeadId++;
+    outboxSize--;
+}
+
+void flushOutbox() {
+    char query[OUTBOX_QUERY_LENGTH] = {0};
+    char response[OUTBOX_QUERY_LENGTH] = {0};
+    uint64_t id;
+    uint32_t spillLength;
+
+    while (true) {
+        if (!peekRequest(query, id, spillLength)) {
+            usleep(OUTBOX_FLUSH_PERIOD_US);
+            continue;
+        }
+
+        //Flushed requests go with the lowest priority, so live safety requests are never delayed by them
+        int sent = 0;
+        if (acquireConnection(BULK_REQUEST, 0) == CONNECTION_ACQUIRED) {
+            sent = (sendRequest(query, response, getRequestDeadline(query)) == REQUEST_SUCCEEDED);
+            releaseConnection(0);
+        }
+
+        if (sent) {
+            //Request signed in a session is out of the server replay window once 64 newer ones were sent,
+            //it can not be signed again here, so the rejected request is reported and discarded
+            if (!strncmp(response, SIGNATURE_FAIL_RESPONSE, strlen(SIGNATURE_FAIL_RESPONSE))) {
+                outboxRejected++;
+                fprintf(stderr, "[%s] Warning: Server rejected signature of a stored request, %u requests were discarded\n",
+                    ENTITY_NAME, outboxRejected);
+            }
+            popRequest(id, spillLength);
+            usleep(OUTBOX_FLUSH_PERIOD_US);
+        }
+        else
+            usleep(OUTBOX_RETRY_PERIOD_US);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,229 @@
+#include "../include/request_scheduler.h"
+#include "../include/server_connector.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+#define SCHEDULER_STATS_PERIOD 100
+#define DEFAULT_REQUEST_DEADLINE_MS 5000
+#define LATENCY_BUCKET_NUMBER 14
+
+struct RequestEndpoint {
+    const char* path;
+    RequestClass requestClass;
+    bool deferrable;
+    bool longPoll;
+    bool idempotent;
+    uint32_t deadlineMs;
+};
+
+struct RequestWaiter {
+    bool superseded;
+};
+
+struct RequestClassStats {
+    uint32_t served;
+    uint32_t expired;
+    uint32_t coalesced;
+    uint64_t totalWaitUs;
+    uint64_t maxWaitUs;
+};
+
+struct RequestLatencyStats {
+    uint32_t timedOut;
+    uint32_t failed;
+    uint32_t buckets[LATENCY_BUCKET_NUMBER];
+};
+
+//ORVD holds arm requests until an operator makes a decision, so they have a long deadline.
+//Such a long poll mostly waits for the operator and does not take a connection from the budget,
+//otherwise it would hold back all control and telemetry requests for minutes.
+//Only idempotent requests are repeated on another server once they were sent, others change the server state
+static const RequestEndpoint requestEndpoints[] = {
+    { "/api/kill_switch", SAFETY_REQUEST, false, false, true, 3000 },
+    { "/api/arm", SAFETY_REQUEST, false, true, false, 120000 },
+    { "/api/fly_accept", SAFETY_REQUEST, false, false, false, 3000 },
+    { "/api/auth", CONTROL_REQUEST, false, false, false, 5000 },
+    { "/api/key", CONTROL_REQUEST, false, false, false, 5000 },
+    { "/api/session", CONTROL_REQUEST, false, false, false, 5000 },
+    { "/api/fmission_kos", CONTROL_REQUEST, false, false, true, 5000 },
+    { "/api/telemetry", TELEMETRY_REQUEST, true, false, true, 2000 },
+    //Samples and roots of the telemetry tree are neither coalesced nor deferred, the server needs all of them in order
+    { "/api/telemetry_sample", CONTROL_REQUEST, false, false, true, 2000 },
+    { "/api/telemetry_root", CONTROL_REQUEST, false, false, false, 5000 },
+    //Telemetry is stored under the log path, it is only flushed from the outbox and is never sent live
+    { "/api/telemetry_log", BULK_REQUEST, true, false, true, 10000 },
+    { "/api/logs", BULK_REQUEST, true, false, false, 10000 }
+};
+static const uint32_t endpointNumber = sizeof(requestEndpoints) / sizeof(requestEndpoints[0]);
+
+static const char* requestClassNames[REQUEST_CLASS_NUMBER] = { "safety", "control", "telemetry", "bulk" };
+static const uint32_t queueDeadlinesMs[REQUEST_CLASS_NUMBER] = { 10000, 10000, 1000, 30000 };
+
+std::mutex schedulerMutex;
+std::condition_variable schedulerCondition;
+std::deque<RequestWaiter*> requestQueues[REQUEST_CLASS_NUMBER];
+RequestClassStats requestStats[REQUEST_CLASS_NUMBER];
+RequestLatencyStats latencyStats[endpointNumber + 1];
+uint32_t busyConnections = 0;
+uint32_t releasedConnections = 0;
+
+const RequestEndpoint* findEndpoint(char* query) {
+    size_t pathLength = strcspn(query, "?");
+    for (const RequestEndpoint &endpoint : requestEndpoints)
+        if ((strlen(endpoint.path) == pathLength) && !strncmp(query, endpoint.path, pathLength))
+            return &endpoint;
+    return NULL;
+}
+
+RequestClass classifyRequest(char* query) {
+    const RequestEndpoint* endpoint = findEndpoint(query);
+    return (endpoint != NULL) ? endpoint->requestClass : BULK_REQUEST;
+}
+
+int isDeferrableRequest(char* query) {
+    const RequestEndpoint* endpoint = findEndpoint(query);
+    return (endpoint != NULL) && endpoint->deferrable;
+}
+
+int isLongPollRequest(char* query) {
+    const RequestEndpoint* endpoint = findEndpoint(query);
+    return (endpoint != NULL) && endpoint->longPoll;
+}
+
+int isIdempotentRequest(char* query) {
+    const RequestEndpoint* endpoint = findEndpoint(query);
+    return (endpoint != NULL) && endpoint->idempotent;
+}
+
+uint32_t getRequestDeadline(char* query) {
+    const RequestEndpoint* endpoint = findEndpoint(query);
+    return (endpoint != NULL) ? endpoint->deadlineMs : DEFAULT_REQUEST_DEADLINE_MS;
+}
+
+const char* getRequestClassName(RequestClass requestClass) {
+    return requestClassNames[requestClass];
+}
+
+bool canProceed(RequestClass requestClass, RequestWaiter* waiter, int longPoll) {
+    if (requestQueues[requestClass].front() != waiter)
+        return false;
+    for (int i = 0; i < requestClass; i++)
+        if (!requestQueues[i].empty())
+            return false;
+    if (longPoll)
+        return true;
+    //The last connection is always kept free for safety-critical requests
+    uint32_t availableConnections = (requestClass == SAFETY_REQUEST) ? MAX_SERVER_CONNECTIONS : MAX_SERVER_CONNECTIONS - 1;
+    return (busyConnections < availableConnections);
+}
+
+int acquireConnection(RequestClass requestClass, int longPoll) {
+    std::unique_lock<std::mutex> lock(schedulerMutex);
+    std::chrono::steady_clock::time_point enqueueTime = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point deadline = enqueueTime + std::chrono::milliseconds(queueDeadlinesMs[requestClass]);
+
+    //Only the most recent telemetry sample is worth sending, older queued ones are dropped
+    if (requestClass == TELEMETRY_REQUEST)
+        for (RequestWaiter* queued : requestQueues[requestClass])
+            queued->superseded = true;
+
+    RequestWaiter waiter = { false };
+    requestQueues[requestClass].push_back(&waiter);
+    schedulerCondition.notify_all();
+
+    int acquired = CONNECTION_ACQUIRED;
+    while (!canProceed(requestClass, &waiter, longPoll)) {
+        if (waiter.superseded) {
+            requestStats[requestClass].coalesced++;
+            acquired = CONNECTION_SUPERSEDED;
+            break;
+        }
+        if ((schedulerCondition.wait_until(lock, deadline) == std::cv_status::timeout) && !canProceed(requestClass, &waiter, longPoll)) {
+            requestStats[requestClass].expired++;
+            acquired = CONNECTION_EXPIRED;
+            break;
+        }
+    }
+
+    std::deque<RequestWaiter*> &queue = requestQueues[requestClass];
+    for (std::deque<RequestWaiter*>::iterator it = queue.begin(); it != queue.end(); it++)
+        if (*it == &waiter) {
+            queue.erase(it);
+            break;
+        }
+
+    uint64_t waitUs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - enqueueTime).count();
+    if (acquired == CONNECTION_ACQUIRED) {
+        if (!longPoll)
+            busyConnections++;
+        requestStats[requestClass].served++;
+        requestStats[requestClass].totalWaitUs += waitUs;
+        if (waitUs > requestStats[requestClass].maxWaitUs)
+            requestStats[requestClass].maxWaitUs = waitUs;
+    }
+    else if (acquired == CONNECTION_SUPERSEDED)
+        fprintf(stderr, "[%s] Info: %s request was replaced by a newer one after %" PRIu64 " us in queue\n", ENTITY_NAME,
+            requestClassNames[requestClass], waitUs);
+    else
+        fprintf(stderr, "[%s] Warning: %s request was dropped after %" PRIu64 " us in queue\n", ENTITY_NAME,
+            requestClassNames[requestClass], waitUs);
+    schedulerCondition.notify_all();
+
+    return acquired;
+}
+
+void releaseConnection(int longPoll) {
+    std::unique_lock<std::mutex> lock(schedulerMutex);
+    if (!longPoll)
+        busyConnections--;
+    releasedConnections++;
+    bool printStats = !(releasedConnections % SCHEDULER_STATS_PERIOD);
+    schedulerCondition.notify_all();
+    lock.unlock();
+
+    if (printStats)
+        printSchedulerStats();
+}
+
+void recordRequestLatency(char* query, int status, uint64_t latencyUs) {
+    const RequestEndpoint* endpoint = findEndpoint(query);
+    uint32_t index = (endpoint != NULL) ? (endpoint - requestEndpoints) : endpointNumber;
+
+    //Bucket i holds latencies below 2^i ms, the last one holds everything above
+    uint32_t bucket = 0;
+    for (uint64_t bound = 1000; (bucket < LATENCY_BUCKET_NUMBER - 1) && (latencyUs >= bound); bound *= 2)
+        bucket++;
+
+    std::lock_guard<std::mutex> lock(schedulerMutex);
+    RequestLatencyStats &stats = latencyStats[index];
+    if (status == REQUEST_TIMED_OUT)
+        stats.timedOut++;
+    else if ((status != REQUEST_SUCCEEDED) && (status != REQUEST_SUPERSEDED))
+        stats.failed++;
+    stats.buckets[bucket]++;
+}
+
+void printSchedulerStats() {
+    std::lock_guard<std::mutex> lock(schedulerMutex);
+    for (int i = 0; i < REQUEST_CLASS_NUMBER; i++) {
+        RequestClassStats &stats = requestStats[i];
+        uint64_t averageWaitUs = stats.served ? (stats.totalWaitUs / stats.served) : 0;
+        fprintf(stderr, "[%s] Info: Queue '%s': served %u, expired %u, coalesced %u, average wait %" PRIu64 " us, max wait %" PRIu64 " us\n",
+            ENTITY_NAME, requestClassNames[i], stats.served, stats.expired, stats.coalesced, averageWaitUs, stats.maxWaitUs);
+    }
+    for (uint32_t i = 0; i <= endpointNumber; i++) {
+        RequestLatencyStats &stats = latencyStats[i];
+        char histogram[LATENCY_BUCKET_NUMBER * 12] = {0};
+        int offset = 0;
+        for (int j = 0; j < LATENCY_BUCKET_NUMBER; j++)
+            offset += snprintf(histogram + offset, sizeof(histogram) - offset, " %u", stats.buckets[j]);
+        fprintf(stderr, "[%s] Info: Latency '%s': timed out %u, failed %u, histogram (<1ms..>=%dms):%s\n", ENTITY_NAME,
+            (i < endpointNumber) ? requestEndpoints[i].path : "other", stats.timedOut, stats.failed, 1 << (LATENCY_BUCKET_NUMBER - 2), histogram);
+    }
+}
\ No newline at end of file
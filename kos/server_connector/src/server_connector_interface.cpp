@@ -1,7 +1,10 @@
 #include "../include/server_connector_interface.h"
 #include "../include/server_connector.h"
+#include "../include/request_scheduler.h"
+#include "../include/request_outbox.h"
 
 #include <string.h>
+#include <chrono>
 
 nk_err_t SendRequestImpl(struct ServerConnectorInterface *self,
                     const ServerConnectorInterface_SendRequest_req *req, const struct nk_arena *reqArena,
@@ -15,7 +18,23 @@ nk_err_t SendRequestImpl(struct ServerConnectorInterface *self,
         return NK_EBADMSG;
     strcpy(query, msg);
 
-    res->success = sendRequest(query, response);
+    RequestClass requestClass = classifyRequest(query);
+    int deferrable = isDeferrableRequest(query);
+    int longPoll = isLongPollRequest(query);
+    int connection = CONNECTION_EXPIRED;
+    //Live requests are always sent directly, only failed ones are stored and flushed in the background.
+    //Queuing them after the outbox would starve live telemetry, as flushing is slower than telemetry rate
+    if ((connection = acquireConnection(requestClass, longPoll)) == CONNECTION_ACQUIRED) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        res->success = sendRequest(query, response, getRequestDeadline(query));
+        recordRequestLatency(query, res->success,
+            std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+        releaseConnection(longPoll);
+        if ((res->success != REQUEST_SUCCEEDED) && deferrable && storeRequest(query))
+            res->success = REQUEST_SUCCEEDED;
+    }
+    else
+        res->success = (connection == CONNECTION_SUPERSEDED) ? REQUEST_SUPERSEDED : REQUEST_FAILED;
 
     msg = nk_arena_alloc(nk_char_t, resArena, &(res->response), strlen(response) + 1);
     if (msg == NULL)
@@ -7,7 +7,7 @@ int initServerConnector() {
     return 1;
 }
 
-int sendRequest(char* query, char* response) {
+int sendRequest(char* query, char* response, uint32_t deadlineMs) {
     if (strstr(query, "/api/kill_switch?") != NULL)
         strcpy(response, "$KillSwitch: 1#");
     else if (strstr(query, "/api/auth?") != NULL)
@@ -19,5 +19,5 @@ int sendRequest(char* query, char* response) {
     else
         strcpy(response, "$#");
 
-    return 1;
+    return REQUEST_SUCCEEDED;
 }
\ No newline at end of file
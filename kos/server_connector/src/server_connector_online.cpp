@@ -1,12 +1,21 @@
 #include "../include/server_connector.h"
+#include "../include/server_socket.h"
+#include "../include/framed_channel.h"
+#include "../include/server_endpoints.h"
+#include "../include/request_scheduler.h"
 
 #include <kos_net.h>
 
-#define BUFFER_SIZE 1024
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
 
-uint16_t serverPort = 8080;
+#define BUFFER_SIZE 1024
 
 int initServerConnector() {
+    if (!initServerEndpoints())
+        return 0;
+
     if (!wait_for_network()) {
         fprintf(stderr, "[%s] Error: Connection to network has failed\n", ENTITY_NAME);
         return 0;
@@ -15,46 +24,156 @@ int initServerConnector() {
     return 1;
 }
 
-int sendRequest(char* query, char* response) {
-    char request[BUFFER_SIZE] = {0};
-    snprintf(request, BUFFER_SIZE, "GET %s HTTP/1.1\r\nHost: %s\r\nConnection: close\r\n\r\n", query, SERVER_IP);
+int waitForSocket(int socketDesc, short events, std::chrono::steady_clock::time_point deadline) {
+    while (true) {
+        int64_t timeout = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+        if (timeout <= 0)
+            return REQUEST_TIMED_OUT;
+
+        struct pollfd descriptor = { socketDesc, events, 0 };
+        int rc = poll(&descriptor, 1, (int)timeout);
+        if (rc > 0)
+            return REQUEST_SUCCEEDED;
+        else if ((rc < 0) && (errno != EINTR))
+            return REQUEST_FAILED;
+    }
+}
 
-    int socketDesc = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+int connectToServer(int &socketDesc, const char* ip, uint16_t port, std::chrono::steady_clock::time_point deadline) {
+    socketDesc = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
     if (socketDesc < 0) {
         fprintf(stderr, "[%s] Warning: Failed to create a socket\n", ENTITY_NAME);
-        return 0;
+        return REQUEST_FAILED;
     }
+    fcntl(socketDesc, F_SETFL, fcntl(socketDesc, F_GETFL, 0) | O_NONBLOCK);
 
     sockaddr_in serverAddress = {0};
     serverAddress.sin_family = AF_INET;
-    serverAddress.sin_port = htons(serverPort);
-    serverAddress.sin_addr.s_addr = inet_addr(SERVER_IP);
+    serverAddress.sin_port = htons(port);
+    serverAddress.sin_addr.s_addr = inet_addr(ip);
     if (connect(socketDesc, (struct sockaddr *)&serverAddress, sizeof(serverAddress)) < 0) {
-	    fprintf(stderr, "[%s] Warning: Connection to %s:%d has failed\n", ENTITY_NAME, SERVER_IP, serverPort);
-		close(socketDesc);
-        return 0;
-	}
+        int status = (errno == EINPROGRESS) ? waitForSocket(socketDesc, POLLOUT, deadline) : REQUEST_FAILED;
+        int error = 0;
+        socklen_t errorLength = sizeof(error);
+        if ((status == REQUEST_SUCCEEDED) && ((getsockopt(socketDesc, SOL_SOCKET, SO_ERROR, &error, &errorLength) < 0) || error))
+            status = REQUEST_FAILED;
+        if (status != REQUEST_SUCCEEDED) {
+            fprintf(stderr, "[%s] Warning: Connection to %s:%d has %s\n", ENTITY_NAME, ip, port,
+                (status == REQUEST_TIMED_OUT) ? "timed out" : "failed");
+            close(socketDesc);
+            socketDesc = -1;
+            return status;
+        }
+    }
+
+    return REQUEST_SUCCEEDED;
+}
+
+int sendToSocket(int socketDesc, const char* data, int length, std::chrono::steady_clock::time_point deadline) {
+    int sentBytes = 0;
+    while (sentBytes < length) {
+        int status = waitForSocket(socketDesc, POLLOUT, deadline);
+        if (status != REQUEST_SUCCEEDED)
+            return status;
+        ssize_t rc = send(socketDesc, data + sentBytes, length - sentBytes, 0);
+        if (rc >= 0)
+            sentBytes += rc;
+        else if ((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR))
+            return REQUEST_FAILED;
+    }
 
-    if (send(socketDesc, request, sizeof(request), 0) < 0) {
-		fprintf(stderr, "[%s] Warning: Failed to send a request\n", ENTITY_NAME);
-	    close(socketDesc);
-		return 0;
-	}
+    return REQUEST_SUCCEEDED;
+}
+
+//Sent is set once the request may have reached the server, so it can not be repeated safely
+int sendHttpRequest(char* query, char* response, uint32_t endpoint, int &sent,
+    std::chrono::steady_clock::time_point connectDeadline, std::chrono::steady_clock::time_point deadline) {
+    const char* ip = getServerEndpointIp(endpoint);
+    char request[BUFFER_SIZE] = {0};
+    int requestLength = snprintf(request, BUFFER_SIZE, "GET %s HTTP/1.1\r\nHost: %s\r\nConnection: close\r\n\r\n", query, ip);
+    if ((requestLength < 0) || (requestLength >= BUFFER_SIZE)) {
+        fprintf(stderr, "[%s] Warning: Request is too long\n", ENTITY_NAME);
+        return REQUEST_FAILED;
+    }
 
-    ssize_t contentLength;
-    char buffer[BUFFER_SIZE] = {0};
+    int socketDesc;
+    int status = connectToServer(socketDesc, ip, getServerEndpointPort(endpoint), connectDeadline);
+    if (status != REQUEST_SUCCEEDED)
+        return status;
+
+    sent = 1;
+    status = sendToSocket(socketDesc, request, requestLength, deadline);
+    if (status != REQUEST_SUCCEEDED) {
+        fprintf(stderr, "[%s] Warning: Failed to send a request%s\n", ENTITY_NAME, (status == REQUEST_TIMED_OUT) ? ": timed out" : "");
+        close(socketDesc);
+        return status;
+    }
+
+    int contentLength = 0;
     char content[BUFFER_SIZE] = {0};
-    while ((contentLength = recv(socketDesc, buffer, sizeof(buffer), 0)) > 0)
-        strncat(content, buffer, contentLength);
+    while (contentLength < BUFFER_SIZE - 1) {
+        status = waitForSocket(socketDesc, POLLIN, deadline);
+        if (status != REQUEST_SUCCEEDED) {
+            fprintf(stderr, "[%s] Warning: Failed to receive a response%s\n", ENTITY_NAME, (status == REQUEST_TIMED_OUT) ? ": timed out" : "");
+            close(socketDesc);
+            return status;
+        }
+        ssize_t rc = recv(socketDesc, content + contentLength, BUFFER_SIZE - 1 - contentLength, 0);
+        if (rc > 0)
+            contentLength += rc;
+        else if (!rc)
+            break;
+        else if ((errno != EAGAIN) && (errno != EWOULDBLOCK)) {
+            fprintf(stderr, "[%s] Warning: Failed to receive a response\n", ENTITY_NAME);
+            close(socketDesc);
+            return REQUEST_FAILED;
+        }
+    }
     close(socketDesc);
+    content[contentLength] = '\0';
 
     char* msg = strstr(content, "$");
     if (msg == NULL) {
         fprintf(stderr, "[%s] Warning: Failed to parse response content\n", ENTITY_NAME);
-		return 0;
+        return REQUEST_FAILED;
     }
 
     strcpy(response, msg);
 
-    return 1;
+    return REQUEST_SUCCEEDED;
+}
+
+int sendRequest(char* query, char* response, uint32_t deadlineMs) {
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(deadlineMs);
+#ifdef FRAMED_CHANNEL_PORT
+    return sendFramedRequest(query, response, deadline);
+#else
+    uint32_t order[MAX_SERVER_ENDPOINTS];
+    uint32_t endpointNumber = getServerEndpointOrder(order);
+    int idempotent = isIdempotentRequest(query);
+
+    int status = REQUEST_FAILED;
+    for (uint32_t i = 0; i < endpointNumber; i++) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        if (start >= deadline) {
+            status = REQUEST_TIMED_OUT;
+            break;
+        }
+        if (i)
+            fprintf(stderr, "[%s] Info: Failing over to server %s:%d\n", ENTITY_NAME,
+                getServerEndpointIp(order[i]), getServerEndpointPort(order[i]));
+
+        //Attempts share the deadline, so an unreachable or hung server leaves time for the next ones.
+        //Request that is not idempotent is never repeated once sent, so it may wait for the answer until the deadline
+        std::chrono::steady_clock::time_point attemptDeadline = start + (deadline - start) / (endpointNumber - i);
+        int sent = 0;
+        status = sendHttpRequest(query, response, order[i], sent, attemptDeadline, idempotent ? attemptDeadline : deadline);
+        reportServerEndpoint(order[i], status,
+            std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+        if ((status == REQUEST_SUCCEEDED) || (sent && !idempotent))
+            break;
+    }
+
+    return status;
+#endif
 }
\ No newline at end of file
@@ -0,0 +1,105 @@
+#include "../include/server_endpoints.h"
+#include "../include/server_connector.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include <mutex>
+
+#ifndef SERVER_ENDPOINTS
+#define SERVER_ENDPOINTS SERVER_IP ":8080"
+#endif
+
+#define ENDPOINT_EWMA_WEIGHT 0.2
+#define ENDPOINT_ERROR_PENALTY_MS 5000.0
+#define ENDPOINT_ERROR_HALF_LIFE_MS 30000.0
+
+struct ServerEndpoint {
+    char ip[16];
+    uint16_t port;
+    double rttMs;
+    double errorRate;
+    std::chrono::steady_clock::time_point lastUpdate;
+};
+
+std::mutex endpointMutex;
+ServerEndpoint serverEndpoints[MAX_SERVER_ENDPOINTS];
+uint32_t serverEndpointNumber = 0;
+
+int initServerEndpoints() {
+    char endpoints[] = SERVER_ENDPOINTS;
+    char* context = NULL;
+    for (char* endpoint = strtok_r(endpoints, ",", &context); endpoint != NULL; endpoint = strtok_r(NULL, ",", &context)) {
+        if (serverEndpointNumber == MAX_SERVER_ENDPOINTS) {
+            fprintf(stderr, "[%s] Warning: Only %d server endpoints are supported\n", ENTITY_NAME, MAX_SERVER_ENDPOINTS);
+            break;
+        }
+        char* portStart = strchr(endpoint, ':');
+        size_t ipLength = (portStart != NULL) ? (size_t)(portStart - endpoint) : strlen(endpoint);
+        if (!ipLength || (ipLength >= sizeof(serverEndpoints[0].ip))) {
+            fprintf(stderr, "[%s] Error: Failed to parse server endpoint '%s'\n", ENTITY_NAME, endpoint);
+            return 0;
+        }
+        ServerEndpoint &server = serverEndpoints[serverEndpointNumber];
+        memcpy(server.ip, endpoint, ipLength);
+        server.ip[ipLength] = '\0';
+        server.port = (portStart != NULL) ? atoi(portStart + 1) : 8080;
+        server.rttMs = 0.0;
+        server.errorRate = 0.0;
+        fprintf(stderr, "[%s] Info: Server endpoint %s:%d is added\n", ENTITY_NAME, server.ip, server.port);
+        serverEndpointNumber++;
+    }
+
+    if (!serverEndpointNumber) {
+        fprintf(stderr, "[%s] Error: No server endpoints are set\n", ENTITY_NAME);
+        return 0;
+    }
+
+    return 1;
+}
+
+double getEndpointScore(ServerEndpoint &server, std::chrono::steady_clock::time_point now) {
+    //Error rate decays with time, so a recovered endpoint is eventually tried again
+    double sinceUpdateMs = std::chrono::duration_cast<std::chrono::milliseconds>(now - server.lastUpdate).count();
+    double errorRate = server.errorRate * pow(0.5, sinceUpdateMs / ENDPOINT_ERROR_HALF_LIFE_MS);
+    return server.rttMs + errorRate * ENDPOINT_ERROR_PENALTY_MS;
+}
+
+uint32_t getServerEndpointOrder(uint32_t* order) {
+    std::lock_guard<std::mutex> lock(endpointMutex);
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    double scores[MAX_SERVER_ENDPOINTS];
+    for (uint32_t i = 0; i < serverEndpointNumber; i++) {
+        scores[i] = getEndpointScore(serverEndpoints[i], now);
+        uint32_t j = i;
+        for (; (j > 0) && (scores[order[j - 1]] > scores[i]); j--)
+            order[j] = order[j - 1];
+        order[j] = i;
+    }
+    return serverEndpointNumber;
+}
+
+const char* getServerEndpointIp(uint32_t index) {
+    return serverEndpoints[index].ip;
+}
+
+uint16_t getServerEndpointPort(uint32_t index) {
+    return serverEndpoints[index].port;
+}
+
+void reportServerEndpoint(uint32_t index, int status, uint64_t latencyUs) {
+    std::lock_guard<std::mutex> lock(endpointMutex);
+    ServerEndpoint &server = serverEndpoints[index];
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    double failure = (status == REQUEST_SUCCEEDED) ? 0.0 : 1.0;
+
+    //Decayed error rate is folded into the stored value, so that the EWMA continues from it
+    double sinceUpdateMs = std::chrono::duration_cast<std::chrono::milliseconds>(now - server.lastUpdate).count();
+    server.errorRate = server.errorRate * pow(0.5, sinceUpdateMs / ENDPOINT_ERROR_HALF_LIFE_MS);
+    server.errorRate += ENDPOINT_EWMA_WEIGHT * (failure - server.errorRate);
+    server.lastUpdate = now;
+    if (status == REQUEST_SUCCEEDED)
+        server.rttMs += ENDPOINT_EWMA_WEIGHT * (latencyUs / 1000.0 - server.rttMs);
+}
\ No newline at end of file
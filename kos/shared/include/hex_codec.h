@@ -0,0 +1,8 @@
+#pragma once
+
+#include <stdint.h>
+
+//Writes 2 * size lowercase hex digits followed by a terminating zero
+void bytesToHex(const uint8_t* source, uint32_t size, char* destination);
+//Decodes hex string into the end of destination, returns 0 if it has characters that are not hex digits
+int hexToBytes(const char* source, uint32_t sourceSize, uint8_t* destination, uint32_t destinationSize);
\ No newline at end of file
@@ -3,4 +3,11 @@
 #include <stdint.h>
 
 int signMessage(char* message, char* signature);
+int beginSign(uint32_t &stream);
+int updateSign(uint32_t stream, uint8_t* chunk, uint32_t chunkSize);
+int finishSign(uint32_t stream, char* signature);
+int cancelSign(uint32_t stream);
+int signLongMessage(char* message, uint32_t messageSize, char* signature);
+int appendTelemetry(char* sample, uint32_t &batch, uint32_t &index);
+int confirmTelemetry(uint32_t batch, uint32_t index, char* root, char* signature);
 int checkSignature(char* message, uint8_t &authenticity);
\ No newline at end of file
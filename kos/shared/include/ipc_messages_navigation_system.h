@@ -3,4 +3,10 @@
 #include <stdint.h>
 
 int getCoords(int32_t &latitude, int32_t &longitude, int32_t &altitude);
-int getGpsInfo(float& dop, int32_t &sats);
\ No newline at end of file
+//Time is in microseconds of the steady clock, which is the same in every entity.
+//Position is interpolated between the fixes stored by Navigation System
+int getCoordsAt(uint64_t time, int32_t &latitude, int32_t &longitude, int32_t &altitude);
+int getGpsInfo(float& dop, int32_t &sats);
+//Ground speed and climb rate are in cm/s, heading in 1e-7 degrees clockwise from the north in (-180, 180],
+//west of the north is negative like in telemetry azimuth
+int getVelocity(int32_t &speed, int32_t &heading, int32_t &climb);
\ No newline at end of file
@@ -1,3 +1,6 @@
 #pragma once
 
-int sendRequest(char* query, char* response);
\ No newline at end of file
+#include <stdint.h>
+
+int sendRequest(char* query, char* response);
+int sendRequest(char* query, char* response, uint8_t &status);
\ No newline at end of file
@@ -0,0 +1,59 @@
+#include "../include/hex_codec.h"
+
+#define INVALID_HEX 0x80
+
+static const char hexDigits[] = "0123456789abcdef";
+
+//Digit values by character, characters that are not hex digits are marked with INVALID_HEX
+static const uint8_t hexValues[256] = {
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80
+};
+
+void bytesToHex(const uint8_t* source, uint32_t size, char* destination) {
+    for (uint32_t i = 0; i < size; i++) {
+        destination[2 * i] = hexDigits[source[i] >> 4];
+        destination[2 * i + 1] = hexDigits[source[i] & 0x0F];
+    }
+    destination[2 * size] = '\0';
+}
+
+int hexToBytes(const char* source, uint32_t sourceSize, uint8_t* destination, uint32_t destinationSize) {
+    const uint8_t* hex = (const uint8_t*)source + sourceSize;
+    uint8_t* bytes = destination + destinationSize;
+    uint32_t pairNumber = sourceSize / 2;
+    if (pairNumber > destinationSize)
+        pairNumber = destinationSize;
+
+    //Invalid digits are decoded as zero, their marks are collected to be checked once
+    uint8_t invalid = 0;
+    for (uint32_t i = 0; i < pairNumber; i++) {
+        hex -= 2;
+        uint8_t high = hexValues[hex[0]];
+        uint8_t low = hexValues[hex[1]];
+        invalid |= high | low;
+        *(--bytes) = (uint8_t)(high << 4) | (low & 0x0F);
+    }
+    //Leading digit of odd-length string makes a byte by itself
+    if ((sourceSize % 2) && (pairNumber < destinationSize)) {
+        uint8_t low = hexValues[(uint8_t)source[0]];
+        invalid |= low;
+        *(--bytes) = low & 0x0F;
+    }
+
+    return !(invalid & INVALID_HEX);
+}
\ No newline at end of file
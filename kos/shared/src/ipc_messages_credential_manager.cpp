@@ -41,6 +41,174 @@ int signMessage(char* message, char* signature) {
     return 1;
 }
 
+int beginSign(uint32_t &stream) {
+    NkKosTransport transport;
+    nk_iid_t riid;
+    initSenderInterface("credential_manager_connection", "drone_controller.CredentialManager.interface", transport, riid);
+
+    struct CredentialManagerInterface_proxy proxy;
+    CredentialManagerInterface_proxy_init(&proxy, &transport.base, riid);
+
+    CredentialManagerInterface_BeginSign_req req;
+    CredentialManagerInterface_BeginSign_res res;
+
+    if ((CredentialManagerInterface_BeginSign(&proxy.base, &req, NULL, &res, NULL) != rcOk) || !res.success)
+        return 0;
+
+    stream = res.stream;
+
+    return 1;
+}
+
+int updateSign(uint32_t stream, uint8_t* chunk, uint32_t chunkSize) {
+    NkKosTransport transport;
+    nk_iid_t riid;
+    initSenderInterface("credential_manager_connection", "drone_controller.CredentialManager.interface", transport, riid);
+
+    struct CredentialManagerInterface_proxy proxy;
+    CredentialManagerInterface_proxy_init(&proxy, &transport.base, riid);
+
+    CredentialManagerInterface_UpdateSign_req req;
+    CredentialManagerInterface_UpdateSign_res res;
+    char reqBuffer[CredentialManagerInterface_UpdateSign_req_arena_size];
+    struct nk_arena reqArena = NK_ARENA_INITIALIZER(reqBuffer, reqBuffer + sizeof(reqBuffer));
+    nk_arena_reset(&reqArena);
+
+    nk_uint8_t *data = nk_arena_alloc(nk_uint8_t, &reqArena, &(req.chunk), chunkSize);
+    if (data == NULL)
+        return 0;
+    memcpy(data, chunk, chunkSize);
+    req.stream = stream;
+
+    if ((CredentialManagerInterface_UpdateSign(&proxy.base, &req, &reqArena, &res, NULL) != rcOk) || !res.success)
+        return 0;
+
+    return 1;
+}
+
+int finishSign(uint32_t stream, char* signature) {
+    NkKosTransport transport;
+    nk_iid_t riid;
+    initSenderInterface("credential_manager_connection", "drone_controller.CredentialManager.interface", transport, riid);
+
+    struct CredentialManagerInterface_proxy proxy;
+    CredentialManagerInterface_proxy_init(&proxy, &transport.base, riid);
+
+    CredentialManagerInterface_FinishSign_req req;
+    CredentialManagerInterface_FinishSign_res res;
+    char resBuffer[CredentialManagerInterface_FinishSign_res_arena_size];
+    struct nk_arena resArena = NK_ARENA_INITIALIZER(resBuffer, resBuffer + sizeof(resBuffer));
+    nk_arena_reset(&resArena);
+    req.stream = stream;
+
+    if ((CredentialManagerInterface_FinishSign(&proxy.base, &req, NULL, &res, &resArena) != rcOk) || !res.success)
+        return 0;
+
+    nk_uint32_t len = 0;
+    nk_char_t *msg = nk_arena_get(nk_char_t, &resArena, &(res.signature), &len);
+    if (msg == NULL)
+        return 0;
+    strcpy(signature, msg);
+
+    return 1;
+}
+
+int cancelSign(uint32_t stream) {
+    NkKosTransport transport;
+    nk_iid_t riid;
+    initSenderInterface("credential_manager_connection", "drone_controller.CredentialManager.interface", transport, riid);
+
+    struct CredentialManagerInterface_proxy proxy;
+    CredentialManagerInterface_proxy_init(&proxy, &transport.base, riid);
+
+    CredentialManagerInterface_CancelSign_req req;
+    CredentialManagerInterface_CancelSign_res res;
+    req.stream = stream;
+
+    if ((CredentialManagerInterface_CancelSign(&proxy.base, &req, NULL, &res, NULL) != rcOk) || !res.success)
+        return 0;
+
+    return 1;
+}
+
+int signLongMessage(char* message, uint32_t messageSize, char* signature) {
+    //Message is sent by parts, so its size is not limited by MaxMessageLength
+    uint32_t stream = 0;
+    if (!beginSign(stream))
+        return 0;
+    for (uint32_t offset = 0; offset < messageSize; offset += CredentialManagerInterface_MaxChunkLength) {
+        uint32_t chunkSize = messageSize - offset;
+        if (chunkSize > CredentialManagerInterface_MaxChunkLength)
+            chunkSize = CredentialManagerInterface_MaxChunkLength;
+        //Failed stream is released at once, otherwise it takes one of few slots until it times out
+        if (!updateSign(stream, (uint8_t*)message + offset, chunkSize)) {
+            cancelSign(stream);
+            return 0;
+        }
+    }
+    return finishSign(stream, signature);
+}
+
+int appendTelemetry(char* sample, uint32_t &batch, uint32_t &index) {
+    NkKosTransport transport;
+    nk_iid_t riid;
+    initSenderInterface("credential_manager_connection", "drone_controller.CredentialManager.interface", transport, riid);
+
+    struct CredentialManagerInterface_proxy proxy;
+    CredentialManagerInterface_proxy_init(&proxy, &transport.base, riid);
+
+    CredentialManagerInterface_AppendTelemetry_req req;
+    CredentialManagerInterface_AppendTelemetry_res res;
+    char reqBuffer[CredentialManagerInterface_AppendTelemetry_req_arena_size];
+    struct nk_arena reqArena = NK_ARENA_INITIALIZER(reqBuffer, reqBuffer + sizeof(reqBuffer));
+    nk_arena_reset(&reqArena);
+
+    nk_char_t *msg = nk_arena_alloc(nk_char_t, &reqArena, &(req.sample), strlen(sample) + 1);
+    if (msg == NULL)
+        return 0;
+    strcpy(msg, sample);
+
+    if ((CredentialManagerInterface_AppendTelemetry(&proxy.base, &req, &reqArena, &res, NULL) != rcOk) || !res.success)
+        return 0;
+
+    batch = res.batch;
+    index = res.index;
+
+    return 1;
+}
+
+int confirmTelemetry(uint32_t batch, uint32_t index, char* root, char* signature) {
+    NkKosTransport transport;
+    nk_iid_t riid;
+    initSenderInterface("credential_manager_connection", "drone_controller.CredentialManager.interface", transport, riid);
+
+    struct CredentialManagerInterface_proxy proxy;
+    CredentialManagerInterface_proxy_init(&proxy, &transport.base, riid);
+
+    CredentialManagerInterface_ConfirmTelemetry_req req;
+    CredentialManagerInterface_ConfirmTelemetry_res res;
+    char resBuffer[CredentialManagerInterface_ConfirmTelemetry_res_arena_size];
+    struct nk_arena resArena = NK_ARENA_INITIALIZER(resBuffer, resBuffer + sizeof(resBuffer));
+    nk_arena_reset(&resArena);
+    req.batch = batch;
+    req.index = index;
+
+    if ((CredentialManagerInterface_ConfirmTelemetry(&proxy.base, &req, NULL, &res, &resArena) != rcOk) || !res.success)
+        return 0;
+
+    nk_uint32_t len = 0;
+    nk_char_t *msg = nk_arena_get(nk_char_t, &resArena, &(res.root), &len);
+    if (msg == NULL)
+        return 0;
+    strcpy(root, msg);
+    msg = nk_arena_get(nk_char_t, &resArena, &(res.signature), &len);
+    if (msg == NULL)
+        return 0;
+    strcpy(signature, msg);
+
+    return 1;
+}
+
 int checkSignature(char* message, uint8_t &authenticity) {
     NkKosTransport transport;
     nk_iid_t riid;
@@ -27,6 +27,29 @@ int getCoords(int32_t &latitude, int32_t &longitude, int32_t &altitude) {
     return 1;
 }
 
+int getCoordsAt(uint64_t time, int32_t &latitude, int32_t &longitude, int32_t &altitude) {
+    NkKosTransport transport;
+    nk_iid_t riid;
+    initSenderInterface("navigation_system_connection", "drone_controller.NavigationSystem.interface", transport, riid);
+
+    struct NavigationSystemInterface_proxy proxy;
+    NavigationSystemInterface_proxy_init(&proxy, &transport.base, riid);
+
+    NavigationSystemInterface_GetCoordsAt_req req;
+    NavigationSystemInterface_GetCoordsAt_res res;
+
+    req.time = time;
+
+    if ((NavigationSystemInterface_GetCoordsAt(&proxy.base, &req, NULL, &res, NULL) != rcOk) || !res.success)
+        return 0;
+
+    latitude = res.lat;
+    longitude = res.lng;
+    altitude = res.alt;
+
+    return 1;
+}
+
 int getGpsInfo(float& dop, int32_t& sats) {
     NkKosTransport transport;
     nk_iid_t riid;
@@ -44,5 +67,26 @@ int getGpsInfo(float& dop, int32_t& sats) {
     memcpy(&dop, &(res.dop), sizeof(float));
     memcpy(&sats, &(res.sats), sizeof(int32_t));
 
+    return 1;
+}
+
+int getVelocity(int32_t &speed, int32_t &heading, int32_t &climb) {
+    NkKosTransport transport;
+    nk_iid_t riid;
+    initSenderInterface("navigation_system_connection", "drone_controller.NavigationSystem.interface", transport, riid);
+
+    struct NavigationSystemInterface_proxy proxy;
+    NavigationSystemInterface_proxy_init(&proxy, &transport.base, riid);
+
+    NavigationSystemInterface_GetVelocity_req req;
+    NavigationSystemInterface_GetVelocity_res res;
+
+    if ((NavigationSystemInterface_GetVelocity(&proxy.base, &req, NULL, &res, NULL) != rcOk) || !res.success)
+        return 0;
+
+    speed = res.speed;
+    heading = res.heading;
+    climb = res.climb;
+
     return 1;
 }
\ No newline at end of file
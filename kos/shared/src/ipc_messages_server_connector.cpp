@@ -7,7 +7,20 @@
 #define NK_USE_UNQUALIFIED_NAMES
 #include <drone_controller/ServerConnectorInterface.idl.h>
 
+//Telemetry sample replaced by a newer one in the Server Connector queue is dropped by design and is not a failure
 int sendRequest(char* query, char* response) {
+    uint8_t status;
+    if (sendRequest(query, response, status))
+        return 1;
+    if (status != ServerConnectorInterface_RequestSuperseded)
+        return 0;
+    response[0] = '\0';
+    return 1;
+}
+
+int sendRequest(char* query, char* response, uint8_t &status) {
+    status = ServerConnectorInterface_RequestFailed;
+
     NkKosTransport transport;
     nk_iid_t riid;
     initSenderInterface("server_connector_connection", "drone_controller.ServerConnector.interface", transport, riid);
@@ -29,7 +42,10 @@ int sendRequest(char* query, char* response) {
         return 0;
     strcpy(msg, query);
 
-    if ((ServerConnectorInterface_SendRequest(&proxy.base, &req, &reqArena, &res, &resArena) != rcOk) || !res.success)
+    if (ServerConnectorInterface_SendRequest(&proxy.base, &req, &reqArena, &res, &resArena) != rcOk)
+        return 0;
+    status = res.success;
+    if (status != ServerConnectorInterface_RequestSucceeded)
         return 0;
 
     nk_uint32_t len = 0;
@@ -39,4 +55,4 @@ int sendRequest(char* query, char* response) {
     strcpy(response, msg);
 
     return 1;
-}
+}
\ No newline at end of file
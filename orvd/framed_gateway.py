@@ -0,0 +1,143 @@
+"""Gateway between the framed drone channel and the ORVD HTTP API.
+
+Each frame starts with a 6-byte header: payload length (2 bytes), frame type
+(1 byte), flags (1 byte), sequence number (2 bytes), all in network byte
+order. Payload is shorter than FRAME_MAX_PAYLOAD, so the drone can store it
+with a terminating null in a buffer of that size. Telemetry and command frames
+carry an API query (for example '/api/telemetry?id=1&...&sig=0x...'), which is
+forwarded to ORVD. With FRAME_FLAG_BINARY_SIGNATURE the '&sig=0x...' parameter
+is cut from the query, and the signature follows it after a zero byte as raw
+bytes. The answer is sent back in a response frame with the same sequence
+number.
+
+With --standalone the gateway does not need ORVD and answers the same way as
+the offline Server Connector does, which is enough to test the channel locally.
+"""
+import argparse
+import socket
+import struct
+import sys
+import threading
+import urllib.error
+import urllib.request
+
+FRAME_HEADER = struct.Struct('!HBBH')
+FRAME_MAX_PAYLOAD = 1024
+
+FRAME_TELEMETRY = 1
+FRAME_COMMAND = 2
+FRAME_RESPONSE = 3
+FRAME_PUSH = 4
+
+FRAME_FLAG_BINARY_SIGNATURE = 0x01
+
+# Answers are not split into frames, so a longer one is replaced with an error the drone does not accept as an ORVD answer
+OVERSIZED_ANSWER = '$Response is too long#'
+
+STANDALONE_ANSWERS = [
+    ('/api/kill_switch?', '$KillSwitch: 1#'),
+    ('/api/auth?', '$Success#'),
+    ('/api/arm?', '$Arm: 0#'),
+    ('/api/fly_accept?', '$Arm: 0#'),
+]
+
+
+def receive_exact(connection: socket.socket, length: int) -> bytes:
+    data = b''
+    while len(data) < length:
+        chunk = connection.recv(length - len(data))
+        if not chunk:
+            raise ConnectionError('channel is closed')
+        data += chunk
+    return data
+
+
+def decode_query(payload: bytes, flags: int) -> str:
+    if not flags & FRAME_FLAG_BINARY_SIGNATURE:
+        return payload.decode()
+    query, _, signature = payload.partition(b'\0')
+    return f'{query.decode()}&sig=0x{signature.hex()}'
+
+
+def standalone_answer(query: str) -> str:
+    for prefix, answer in STANDALONE_ANSWERS:
+        if query.startswith(prefix):
+            return answer
+    return '$#'
+
+
+def orvd_answer(orvd_url: str, query: str) -> str:
+    try:
+        with urllib.request.urlopen(orvd_url + query, timeout=120) as answer:
+            return answer.read().decode()
+    except urllib.error.HTTPError as error:
+        return error.read().decode()
+    except Exception as error:
+        print(f'failed to forward {query}: {error}', file=sys.stderr)
+        return ''
+
+
+class DroneChannel:
+    def __init__(self, connection: socket.socket, answer_func):
+        self.connection = connection
+        self.answer_func = answer_func
+        self.write_lock = threading.Lock()
+
+    def send_frame(self, frame_type: int, sequence: int, payload: str):
+        data = payload.encode()
+        if len(data) >= FRAME_MAX_PAYLOAD:
+            raise ValueError(f'payload of {len(data)} bytes does not fit into a frame')
+        with self.write_lock:
+            self.connection.sendall(FRAME_HEADER.pack(len(data), frame_type, 0, sequence) + data)
+
+    def handle_request(self, sequence: int, query: str):
+        answer = self.answer_func(query)
+        if len(answer.encode()) >= FRAME_MAX_PAYLOAD:
+            print(f'answer to {query} does not fit into {FRAME_MAX_PAYLOAD - 1} bytes and is not sent', file=sys.stderr)
+            answer = OVERSIZED_ANSWER
+        try:
+            self.send_frame(FRAME_RESPONSE, sequence, answer)
+        except OSError:
+            pass
+
+    def serve(self):
+        try:
+            while True:
+                length, frame_type, flags, sequence = FRAME_HEADER.unpack(receive_exact(self.connection, FRAME_HEADER.size))
+                if length >= FRAME_MAX_PAYLOAD:
+                    break
+                query = decode_query(receive_exact(self.connection, length), flags)
+                if frame_type in (FRAME_TELEMETRY, FRAME_COMMAND):
+                    threading.Thread(target=self.handle_request, args=(sequence, query), daemon=True).start()
+                else:
+                    print(f'unexpected frame of type {frame_type}', file=sys.stderr)
+        except (ConnectionError, OSError):
+            pass
+        finally:
+            self.connection.close()
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Framed channel gateway for ORVD')
+    parser.add_argument('--port', type=int, default=8081)
+    parser.add_argument('--orvd', default='http://127.0.0.1:8080')
+    parser.add_argument('--standalone', action='store_true')
+    args = parser.parse_args()
+
+    if args.standalone:
+        answer_func = standalone_answer
+    else:
+        answer_func = lambda query: orvd_answer(args.orvd, query)
+
+    server = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    server.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    server.bind(('0.0.0.0', args.port))
+    server.listen()
+    while True:
+        connection, address = server.accept()
+        print(f'drone connected from {address[0]}:{address[1]}', file=sys.stderr)
+        threading.Thread(target=DroneChannel(connection, answer_func).serve, daemon=True).start()
+
+
+if __name__ == '__main__':
+    main()
\ No newline at end of file
@@ -209,8 +209,25 @@ def key_kos_exchange():
     id = cast_wrapper(request.args.get('id'), int)
     n = request.args.get('n')
     e = request.args.get('e')
+    algs = request.args.get('algs')
+    ec = request.args.get('ec')
+    tree = request.args.get('tree')
+    sig = request.args.get('sig')
     if id:
-        return regular_request(handler_func=key_kos_exchange_handler, id=id, n=n, e=e)
+        query_str = f'/api/key?id={id}&e={e}&n={n}&algs={algs}&ec={ec}' + (f'&tree={tree}' if tree != None else '')
+        return regular_request(handler_func=key_kos_exchange_handler, id=id, n=n, e=e, algs=algs, ec=ec, tree=tree,
+                               query_str=query_str, sig=sig)
+    else:
+        return bad_request('Wrong id')
+
+
+@app.route('/api/session')
+def session_kos_exchange():
+    id = cast_wrapper(request.args.get('id'), int)
+    sig = request.args.get('sig')
+    if id:
+        return signed_request(handler_func=session_handler, verifier_func=verify, signer_func=sign,
+                          query_str=f'/api/session?id={id}', key_group=f'kos{id}', sig=sig, id=id)
     else:
         return bad_request('Wrong id')
 
@@ -261,6 +278,57 @@ def telemetry():
                           key_group=f'kos{id}', sig=sig, id=id, lat=lat, lon=lon, alt=alt, azimuth=azimuth, dop=dop, sats=sats)
     else:
         return bad_request('Wrong id')
+
+@app.route('/api/telemetry_log')
+def telemetry_log():
+    id = cast_wrapper(request.args.get('id'), int)
+    sig = request.args.get('sig')
+    lat = request.args.get('lat')
+    lon = request.args.get('lon')
+    alt = request.args.get('alt')
+    azimuth = request.args.get('azimuth')
+    dop = request.args.get('dop')
+    sats = request.args.get('sats')
+    if id:
+        # отложенная телеметрия подписана как обычная, но только дописывается в журнал трека
+        query_str = f'/api/telemetry?id={id}&lat={lat}&lon={lon}&alt={alt}&azimuth={azimuth}&dop={dop}&sats={sats}'
+        return signed_request(handler_func=telemetry_log_handler, verifier_func=verify, signer_func=sign,
+                          query_str=query_str, key_group=f'kos{id}', sig=sig, id=id, sample=query_str)
+    else:
+        return bad_request('Wrong id')
+
+@app.route('/api/telemetry_sample')
+def telemetry_sample():
+    id = cast_wrapper(request.args.get('id'), int)
+    lat = request.args.get('lat')
+    lon = request.args.get('lon')
+    alt = request.args.get('alt')
+    azimuth = request.args.get('azimuth')
+    dop = request.args.get('dop')
+    sats = request.args.get('sats')
+    batch = cast_wrapper(request.args.get('batch'), int)
+    leaf = cast_wrapper(request.args.get('leaf'), int)
+    if id and batch != None and leaf != None:
+        # лист дерева - это сообщение телеметрии в том виде, в котором оно подписывалось бы отдельно
+        return tree_sample_request(handler_func=telemetry_sample_handler, signer_func=sign,
+                                   query_str=f'/api/telemetry?id={id}&lat={lat}&lon={lon}&alt={alt}&azimuth={azimuth}&dop={dop}&sats={sats}',
+                                   key_group=f'kos{id}', batch=batch, leaf=leaf, id=id)
+    else:
+        return bad_request('Wrong id/batch/leaf')
+
+@app.route('/api/telemetry_root')
+def telemetry_root():
+    id = cast_wrapper(request.args.get('id'), int)
+    sig = request.args.get('sig')
+    batch = cast_wrapper(request.args.get('batch'), int)
+    count = cast_wrapper(request.args.get('count'), int)
+    root = request.args.get('root')
+    if id and batch != None and count:
+        return signed_request(handler_func=telemetry_root_handler, verifier_func=verify, signer_func=sign,
+                          query_str=f'/api/telemetry_root?id={id}&batch={batch}&count={count}&root={root}',
+                          key_group=f'kos{id}', sig=sig, id=id, batch=batch, count=count, root=root, signature=sig)
+    else:
+        return bad_request('Wrong id/batch/count')
     
 @app.route('/api/kill_switch')
 def kill_switch():
@@ -1,5 +1,6 @@
-from utils.utils import ORVD_KEY_SIZE, generate_keys
+from utils.utils import ORVD_KEY_SIZE, generate_keys, generate_ecc_key
 import os
 import sys
 
-generate_keys(ORVD_KEY_SIZE, 'orvd')
\ No newline at end of file
+generate_keys(ORVD_KEY_SIZE, 'orvd')
+generate_ecc_key('orvd')
\ No newline at end of file
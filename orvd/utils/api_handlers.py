@@ -7,15 +7,42 @@ def bad_request(message: str):
     return message, 400
         
 def signed_request(handler_func, verifier_func, signer_func, query_str, key_group, sig, **kwargs):
-    if sig != None and verifier_func(query_str, int(sig, 16), key_group):
+    session_epoch = 0
+    ecdsa_negotiated = signature_algorithms.get(key_group) == 'ecdsa-p256'
+    if sig != None and is_session_token(sig, key_group):
+        session_epoch = verify_session(query_str, sig, key_group)
+        verified = session_epoch != 0
+    elif sig != None and ecdsa_negotiated and verify_ecdsa(query_str, sig, key_group):
+        verified = True
+    else:
+        verified = sig != None and verifier_func(query_str, int(sig, 16), key_group)
+    if verified:
         answer = handler_func(**kwargs)
         ret_code = 200
     else:
         print(f'failed to verify {query_str}', file=sys.stderr)
         answer = '$Signature verification fail'
         ret_code = 403
-    answer = f'{answer}#{hex(signer_func(answer, "orvd"))[2:]}'
-    return answer, ret_code
+    return sign_answer(answer, signer_func, key_group, session_epoch), ret_code
+
+def sign_answer(answer, signer_func, key_group, session_epoch=0):
+    # ответ на запрос с сессионным ключом подписывается тем же ключом
+    session_token = sign_session(answer, key_group, session_epoch) if session_epoch else None
+    if session_token:
+        return f'{answer}#{session_token}'
+    elif signature_algorithms.get(key_group) == 'ecdsa-p256':
+        return f'{answer}#{sign_ecdsa(answer, "orvd")}'
+    else:
+        return f'{answer}#{hex(signer_func(answer, "orvd"))[2:]}'
+
+def tree_sample_request(handler_func, signer_func, query_str, key_group, batch, leaf, **kwargs):
+    # образец телеметрии без подписи только запоминается, в базу он попадает после проверки подписанного корня пакета
+    if not is_telemetry_tree_enabled(key_group):
+        print(f'telemetry tree is not enabled for {key_group}', file=sys.stderr)
+        return sign_answer('$Signature verification fail', signer_func, key_group), 403
+    add_telemetry_sample(key_group, batch, leaf, query_str)
+    answer = handler_func(**kwargs)
+    return sign_answer(answer, signer_func, key_group), 200
 
 def authorized_request(handler_func, token, **kwargs):
     if check_user_token(token):
@@ -43,13 +70,31 @@ def regular_request(handler_func, **kwargs):
     return answer, ret_code
 
     
-def key_kos_exchange_handler(id: int, n: str, e: str):
+def key_kos_exchange_handler(id: int, n: str, e: str, algs: str = None, ec: str = None, tree: str = None,
+                             query_str: str = None, sig: str = None):
     n, e = str(int(n, 16)), str(int(e, 16))
     key_entity = get_entity_by_key(UavPublicKeys, id)
-    if key_entity == None:
-        save_public_key(n, e, f'kos{id}')
+    # запрос подписан ключом из самого запроса, и этот ключ должен совпадать с закрепленным при первой регистрации
+    authenticated = sig != None and verify_with_key(query_str, int(sig, 16), int(n), int(e))
+    if key_entity != None and (key_entity.n != n or key_entity.e != e):
+        authenticated = False
     orvd_n, orvd_e = get_key('orvd', private=False)
     str_to_send = f'$Key: {hex(orvd_n)[2:]} {hex(orvd_e)[2:]}'
+    if not authenticated:
+        # без подписи выдается только открытый ключ ОРВД, состояние дрона не меняется
+        print(f'key exchange of kos{id} is not authenticated', file=sys.stderr)
+        return str_to_send
+    if key_entity == None:
+        save_public_key(n, e, f'kos{id}')
+    close_session(f'kos{id}')
+    # образцы без подписи принимаются только от дрона, который запросил дерево телеметрии при обмене ключами
+    reset_telemetry_tree(f'kos{id}', tree == '1')
+    # дрон, предложивший алгоритмы подписи, получает выбранный алгоритм и ключ ОРВД для него
+    algorithm = negotiate_signature_algorithm(f'kos{id}', algs, ec)
+    if algorithm == 'ecdsa-p256':
+        str_to_send += f' {algorithm} {get_ecc_public_key("orvd")}'
+    elif algorithm:
+        str_to_send += f' {algorithm}'
     return str_to_send
 
 def key_ms_exchange_handler(id: int):
@@ -70,6 +115,15 @@ def key_ms_exchange_handler(id: int):
     str_to_send = f'$Key: {hex(orvd_n)[2:]} {hex(orvd_e)[2:]}'
     return str_to_send
 
+def session_handler(id: int):
+    key_set = get_key(f'kos{id}', private=False)
+    if key_set == -1:
+        return NOT_FOUND
+    n, e = key_set
+    session_key = open_session(f'kos{id}')
+    encrypted_key = pow(int.from_bytes(session_key.key, byteorder='big', signed=False), e, n)
+    return f'$Session: {session_key.epoch:x} {hex(encrypted_key)[2:]}'
+
 def auth_handler(id: int):
     uav_entity = get_entity_by_key(Uav, id)
     if not uav_entity:
@@ -166,6 +220,54 @@ def telemetry_handler(id: int, lat: float, lon: float, alt: float,
         else:
             return f'$Arm: {ARMED}'
     
+def telemetry_sample_handler(id: int):
+    uav_entity = get_entity_by_key(Uav, id)
+    if not uav_entity:
+        return NOT_FOUND
+    # образец еще не подтвержден корнем, поэтому дрону возвращается только состояние арма, как на обычную телеметрию
+    if not uav_entity.is_armed:
+        return f'$Arm: {DISARMED}'
+    else:
+        return f'$Arm: {ARMED}'
+
+def telemetry_log_handler(id: int, sample: str):
+    uav_entity = get_entity_by_key(Uav, id)
+    if not uav_entity:
+        return NOT_FOUND
+    # устаревший образец не меняет текущее положение дрона, он только заполняет пропуск в треке
+    try:
+        if not os.path.exists(LOGS_PATH):
+            os.makedirs(LOGS_PATH)
+        with open(f'{LOGS_PATH}/{id}_track.txt', 'a') as f:
+            f.write(f'{sample}\n')
+    except Exception as e:
+        print(e)
+    return OK
+
+def telemetry_root_handler(id: int, batch: int, count: int, root: str, signature: str):
+    uav_entity = get_entity_by_key(Uav, id)
+    if not uav_entity:
+        return NOT_FOUND
+    samples = close_telemetry_batch(f'kos{id}', batch, count, root)
+    if samples == None:
+        print(f'telemetry batch {batch} of kos{id} does not match its root', file=sys.stderr)
+        return '$Telemetry batch mismatch'
+    # положение дрона обновляется последним образцом пакета, подлинность которого теперь подтверждена
+    sample = dict(parse_qsl(samples[-1].split('?', 1)[1]))
+    telemetry_handler(id=id, lat=sample.get('lat'), lon=sample.get('lon'), alt=sample.get('alt'),
+                      azimuth=sample.get('azimuth'), dop=sample.get('dop'), sats=sample.get('sats'))
+    # для каждого образца сохраняется путь до подписанного корня, чтобы проверять образцы по одному после полета
+    try:
+        if not os.path.exists(LOGS_PATH):
+            os.makedirs(LOGS_PATH)
+        leaves = [tree_leaf_hash(sample) for sample in samples]
+        with open(f'{LOGS_PATH}/{id}_telemetry.txt', 'a') as f:
+            for index, sample in enumerate(samples):
+                proof = ','.join(node.hex() for node in tree_proof(leaves, index))
+                f.write(f'{batch};{index};{count};{root};{signature};{proof};{sample}\n')
+    except Exception as e:
+        print(e)
+    return OK
 
 def fmission_kos_handler(id: int):
     uav_entity = get_entity_by_key(Uav, id)
@@ -1,9 +1,14 @@
+import hmac
 import math
 import os, sys
+import threading
 import time
+from urllib.parse import parse_qsl
 from hashlib import sha256
 from Cryptodome import Random
-from Cryptodome.PublicKey import RSA
+from Cryptodome.Hash import SHA256
+from Cryptodome.PublicKey import ECC, RSA
+from Cryptodome.Signature import DSS
 from models import *
 from utils.db_utils import *
 
@@ -24,7 +29,28 @@ OK = '$OK'
 
 LOGS_PATH = './logs'
 
+SESSION_KEY_SIZE = 32
+SESSION_REPLAY_WINDOW = 64
+# эпоха (8 hex), счетчик (16 hex) и HMAC-SHA256 (64 hex)
+SESSION_TOKEN_LENGTH = 88
+
+# алгоритмы подписи в порядке предпочтения
+SIGNATURE_ALGORITHMS = ['ecdsa-p256', 'rsa']
+
+# префиксы листа и узла дерева телеметрии как в RFC 6962
+TREE_LEAF_PREFIX = b'\x00'
+TREE_NODE_PREFIX = b'\x01'
+# пакеты, корень которых еще не пришел; более старые считаются потерянными
+TELEMETRY_TREE_PENDING_BATCHES = 4
+
 loaded_keys = {}
+loaded_ecc_keys = {}
+signature_algorithms = {}
+sessions = {}
+sessions_lock = threading.Lock()
+telemetry_trees = {}
+telemetry_tree_drones = set()
+telemetry_trees_lock = threading.Lock()
 
 
 def get_sha256_hex(message: str) -> str:
@@ -145,16 +171,231 @@ def verify(message: str, signature: int, key_group: str) -> bool:
             n, e = key_set
         else:
             return False
-        msg_bytes = message.encode()
-        hash = int.from_bytes(sha256(msg_bytes).digest(), byteorder='big', signed=False)
-        hashFromSignature = pow(signature, e, n)
-        return hash == hashFromSignature
+        return verify_with_key(message, signature, n, e)
     except:
         return False
 
+
+def verify_with_key(message: str, signature: int, n: int, e: int) -> bool:
+    msg_bytes = message.encode()
+    hash = int.from_bytes(sha256(msg_bytes).digest(), byteorder='big', signed=False)
+    hashFromSignature = pow(signature, e, n)
+    return hash == hashFromSignature
+
+def generate_ecc_key(key_group: str) -> None:
+    loaded_ecc_keys[key_group] = ECC.generate(curve='P-256')
+
+
+def get_ecc_public_key(key_group: str) -> str:
+    point = loaded_ecc_keys[key_group].pointQ
+    return '04' + int(point.x).to_bytes(32, 'big').hex() + int(point.y).to_bytes(32, 'big').hex()
+
+
+def negotiate_signature_algorithm(key_group: str, algs: str, ec: str) -> str:
+    signature_algorithms.pop(key_group, None)
+    if not algs:
+        return None
+    offered = algs.split(',')
+    for algorithm in SIGNATURE_ALGORITHMS:
+        if algorithm not in offered:
+            continue
+        if algorithm == 'ecdsa-p256':
+            try:
+                point = bytes.fromhex(ec[2:] if ec.startswith('0x') else ec)
+                if len(point) != 65 or point[0] != 4:
+                    continue
+                loaded_ecc_keys[key_group] = ECC.construct(curve='P-256', point_x=int.from_bytes(point[1:33], 'big'),
+                                                           point_y=int.from_bytes(point[33:], 'big'))
+            except (AttributeError, ValueError):
+                continue
+        signature_algorithms[key_group] = algorithm
+        return algorithm
+    return None
+
+
+def sign_ecdsa(message: str, key_group: str) -> str:
+    # детерминированная подпись: одинаковые ответы совпадают побайтово и кэшируются дроном
+    signer = DSS.new(loaded_ecc_keys[key_group], 'deterministic-rfc6979')
+    return signer.sign(SHA256.new(message.encode())).hex()
+
+
+def verify_ecdsa(message: str, signature: str, key_group: str) -> bool:
+    if key_group not in loaded_ecc_keys:
+        return False
+    try:
+        verifier = DSS.new(loaded_ecc_keys[key_group], 'fips-186-3')
+        verifier.verify(SHA256.new(message.encode()), bytes.fromhex(signature[2:] if signature.startswith('0x') else signature))
+        return True
+    except ValueError:
+        return False
+
+
 # для теста
 def mock_verifier(*args, **kwargs):
     return True
+
+
+class SessionKey:
+    def __init__(self, epoch: int):
+        self.epoch = epoch
+        self.key = os.urandom(SESSION_KEY_SIZE)
+        self.sent_counter = 0
+        self.received_counter = 0
+        self.received_window = 0
+
+    def accept_counter(self, counter: int) -> bool:
+        # счетчики могут приходить не по порядку, поэтому повтор проверяется по окну
+        if counter > self.received_counter:
+            shift = counter - self.received_counter
+            self.received_window = ((self.received_window << shift) | 1) & ((1 << SESSION_REPLAY_WINDOW) - 1)
+            self.received_counter = counter
+            return True
+        offset = self.received_counter - counter
+        if offset >= SESSION_REPLAY_WINDOW or (self.received_window >> offset) & 1:
+            return False
+        self.received_window |= 1 << offset
+        return True
+
+
+def session_mac(key: bytes, direction: bytes, epoch: int, counter: int, message: str) -> str:
+    data = direction + epoch.to_bytes(4, 'big') + counter.to_bytes(8, 'big') + message.encode()
+    return hmac.new(key, data, sha256).hexdigest()
+
+
+def open_session(key_group: str) -> SessionKey:
+    with sessions_lock:
+        keys = sessions.setdefault(key_group, [])
+        epoch = keys[-1].epoch + 1 if keys else 1
+        keys.append(SessionKey(epoch))
+        # предыдущий ключ остается действительным, пока дрон не перейдет на новый
+        del keys[:-2]
+        return keys[-1]
+
+
+def close_session(key_group: str) -> None:
+    with sessions_lock:
+        sessions.pop(key_group, None)
+
+
+def is_session_token(token: str, key_group: str) -> bool:
+    if token.startswith('0x'):
+        token = token[2:]
+    return len(token) == SESSION_TOKEN_LENGTH and key_group in sessions
+
+
+def verify_session(message: str, token: str, key_group: str) -> int:
+    if token.startswith('0x'):
+        token = token[2:]
+    try:
+        epoch, counter, mac = int(token[:8], 16), int(token[8:24], 16), token[24:]
+    except ValueError:
+        return 0
+    with sessions_lock:
+        for session_key in sessions.get(key_group, []):
+            if session_key.epoch == epoch:
+                if hmac.compare_digest(session_mac(session_key.key, b'D', epoch, counter, message), mac.lower()) \
+                        and session_key.accept_counter(counter):
+                    return epoch
+                return 0
+    return 0
+
+
+def sign_session(message: str, key_group: str, epoch: int) -> str:
+    with sessions_lock:
+        for session_key in sessions.get(key_group, []):
+            if session_key.epoch == epoch:
+                session_key.sent_counter += 1
+                counter = session_key.sent_counter
+                return f'{epoch:08x}{counter:016x}{session_mac(session_key.key, b"S", epoch, counter, message)}'
+    return None
+
+
+def tree_leaf_hash(sample: str) -> bytes:
+    return sha256(TREE_LEAF_PREFIX + sample.encode()).digest()
+
+
+def tree_node_hash(left: bytes, right: bytes) -> bytes:
+    return sha256(TREE_NODE_PREFIX + left + right).digest()
+
+
+def tree_split(count: int) -> int:
+    # листья делятся по наибольшей степени двойки, меньшей их числа
+    split = 1
+    while 2 * split < count:
+        split *= 2
+    return split
+
+
+def tree_root(leaves: list) -> bytes:
+    if len(leaves) == 1:
+        return leaves[0]
+    split = tree_split(len(leaves))
+    return tree_node_hash(tree_root(leaves[:split]), tree_root(leaves[split:]))
+
+
+def tree_proof(leaves: list, index: int) -> list:
+    # хэши соседних поддеревьев от листа к корню
+    if len(leaves) == 1:
+        return []
+    split = tree_split(len(leaves))
+    if index < split:
+        return tree_proof(leaves[:split], index) + [tree_root(leaves[split:])]
+    return tree_proof(leaves[split:], index - split) + [tree_root(leaves[:split])]
+
+
+def verify_tree_proof(sample: str, index: int, count: int, proof: list, root: bytes) -> bool:
+    # проверка включения по RFC 9162 (2.1.3.2), нужен только путь длиной O(log n)
+    if index >= count:
+        return False
+    fn, sn = index, count - 1
+    result = tree_leaf_hash(sample)
+    for node in proof:
+        if sn == 0:
+            return False
+        if fn & 1 or fn == sn:
+            result = tree_node_hash(node, result)
+            while not fn & 1 and fn != 0:
+                fn >>= 1
+                sn >>= 1
+        else:
+            result = tree_node_hash(result, node)
+        fn >>= 1
+        sn >>= 1
+    return sn == 0 and result == root
+
+
+def add_telemetry_sample(key_group: str, batch: int, index: int, sample: str) -> None:
+    with telemetry_trees_lock:
+        batches = telemetry_trees.setdefault(key_group, {})
+        batches.setdefault(batch, {})[index] = sample
+        for old_batch in sorted(batches)[:-TELEMETRY_TREE_PENDING_BATCHES]:
+            del batches[old_batch]
+
+
+def close_telemetry_batch(key_group: str, batch: int, count: int, root: str) -> list:
+    # возвращает образцы пакета, если они все получены и совпадают с подписанным корнем
+    with telemetry_trees_lock:
+        samples = telemetry_trees.get(key_group, {}).pop(batch, {})
+    if sorted(samples) != list(range(count)):
+        return None
+    samples = [samples[i] for i in range(count)]
+    if tree_root([tree_leaf_hash(sample) for sample in samples]).hex() != root.lower():
+        return None
+    return samples
+
+
+def reset_telemetry_tree(key_group: str, enabled: bool) -> None:
+    with telemetry_trees_lock:
+        telemetry_trees.pop(key_group, None)
+        if enabled:
+            telemetry_tree_drones.add(key_group)
+        else:
+            telemetry_tree_drones.discard(key_group)
+
+
+def is_telemetry_tree_enabled(key_group: str) -> bool:
+    with telemetry_trees_lock:
+        return key_group in telemetry_tree_drones
         
 def get_key(key_group: str, private: bool):
     if private == True: